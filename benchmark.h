@@ -134,5 +134,73 @@ inline void RunBenchmark(const size_t I) {
 	elapsed = t.Elapsed();
 	SEECS_MSG(" - " << elapsed << "s");
 
+	SEECS_MSG("Running 'Accessor .Get<...>() (4 components)' benchmark [" << I << "] entities");
+	auto accessor = ecs.Accessor<Dummy<int>, Dummy<double>, Dummy<long>, Dummy<float>>();
+	t.Reset();
+	for (size_t i = 0; i < I; i++) {
+		accessor.Get<Dummy<int>>(ids[i]);
+		accessor.Get<Dummy<double>>(ids[i]);
+		accessor.Get<Dummy<long>>(ids[i]);
+		accessor.Get<Dummy<float>>(ids[i]);
+	}
+	elapsed = t.Elapsed();
+	SEECS_MSG(" - " << elapsed << "s");
+
+	SEECS_MSG("Running 'create + add (4 components)' benchmark [" << I << "] entities");
+	t.Reset();
+	for (size_t i = 0; i < I; i++) {
+		EntityID id = ecs.CreateEntity();
+		ecs.Add<Dummy<int>>(id, {});
+		ecs.Add<Dummy<double>>(id, {});
+		ecs.Add<Dummy<long>>(id, {});
+		ecs.Add<Dummy<float>>(id, {});
+	}
+	elapsed = t.Elapsed();
+	SEECS_MSG(" - " << elapsed << "s");
+
+	SEECS_MSG("Running 'Instantiate prefab (4 components)' benchmark [" << I << "] entities");
+	Prefab prefab;
+	prefab.Add<Dummy<int>>().Add<Dummy<double>>().Add<Dummy<long>>().Add<Dummy<float>>();
+	t.Reset();
+	ecs.Instantiate(prefab, I);
+	elapsed = t.Elapsed();
+	SEECS_MSG(" - " << elapsed << "s");
+
+
+}
+
+/*
+*  Replays a trace recorded with ECS::StartRecording() into a fresh world, reporting the
+*  total time and the time per frame. Components are the types used in the trace, which have
+*  to be known to this program before replaying:
+*
+*    RunReplayBenchmark<Transform, Sprite, Health>(trace);
+*/
+template <typename... Components>
+inline void RunReplayBenchmark(const seecs::Trace& trace) {
+	using namespace seecs;
+
+	Timer t;
+	Timer frame;
+	ECS ecs;
+	ecs.RegisterComponents<Components...>();
+
+	std::vector<float> frames;
+
+	SEECS_MSG("Running 'replay trace' benchmark [" << trace.bytes.size() << "] bytes");
+	t.Reset();
+	frame.Reset();
+	size_t operations = ecs.ReplayTrace(trace, [&]() {
+		frames.push_back(frame.Elapsed());
+		frame.Reset();
+	});
+	float elapsed = t.Elapsed();
+	SEECS_MSG(" - " << elapsed << "s, " << operations << " operations");
+
+	if (frames.empty())
+		return;
 
-}
\ No newline at end of file
+	std::sort(frames.begin(), frames.end());
+	SEECS_MSG(" - " << frames.size() << " frames, median " << frames[frames.size() / 2]
+		<< "s, 99th percentile " << frames[frames.size() * 99 / 100] << "s, worst " << frames.back() << "s");
+}
@@ -0,0 +1,489 @@
+#ifndef SEECS_SCHEDULER_H
+#define SEECS_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <vector>
+#include "seecs.h"
+
+namespace seecs {
+
+	/*
+	*  Declares access to a resource (see ECS::SetResource) in Scheduler::AddSystem,
+	*  e.g Res<const Time> to read it or Res<Input> to write it.
+	*/
+	template <typename T>
+	struct Res {};
+
+	template <typename T>
+	struct is_resource_access : std::false_type {};
+
+	template <typename T>
+	struct is_resource_access<Res<T>> : std::true_type {};
+
+	// SimpleView over the component part of an access pack, dropping any Res<...>
+	template <typename View, typename... Access>
+	struct component_view {
+		using type = View;
+	};
+
+	template <typename... Components, typename Access, typename... Rest>
+	struct component_view<SimpleView<Components...>, Access, Rest...> :
+		component_view<std::conditional_t<is_resource_access<Access>::value,
+			SimpleView<Components...>, SimpleView<Components..., Access>>, Rest...> {};
+
+	/*
+	*  Fixed size work-stealing thread pool.
+	*
+	*  Every worker owns a task queue. Tasks submitted from a worker go to its own queue
+	*  and are popped LIFO, idle workers steal the oldest task from the other queues.
+	*/
+	class ThreadPool {
+	private:
+
+		using Task = std::function<void()>;
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		std::vector<std::unique_ptr<Queue>> m_queues;
+		std::vector<std::thread> m_threads;
+
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+		std::atomic<size_t> m_queuedTasks{ 0 };
+		std::atomic<size_t> m_nextQueue{ 0 };
+		bool m_stop = false;
+
+		// Identifies the worker (if any) running on the current thread
+		inline static thread_local ThreadPool* t_pool = nullptr;
+		inline static thread_local size_t t_workerIndex = 0;
+
+		bool TryPop(size_t self, Task& task) {
+			{
+				Queue& own = *m_queues[self];
+				std::lock_guard<std::mutex> lock{ own.mutex };
+				if (!own.tasks.empty()) {
+					task = std::move(own.tasks.back());
+					own.tasks.pop_back();
+					return true;
+				}
+			}
+
+			for (size_t offset = 1; offset < m_queues.size(); offset++) {
+				Queue& victim = *m_queues[(self + offset) % m_queues.size()];
+				std::lock_guard<std::mutex> lock{ victim.mutex };
+				if (!victim.tasks.empty()) {
+					task = std::move(victim.tasks.front());
+					victim.tasks.pop_front();
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void WorkerLoop(size_t index) {
+			t_pool = this;
+			t_workerIndex = index;
+
+			Task task;
+			while (true) {
+				if (TryPop(index, task)) {
+					m_queuedTasks--;
+					task();
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock{ m_sleepMutex };
+				m_wake.wait(lock, [this] { return m_stop || m_queuedTasks > 0; });
+				if (m_stop && m_queuedTasks == 0)
+					return;
+			}
+		}
+
+	public:
+
+		ThreadPool(size_t threadCount = std::thread::hardware_concurrency()) {
+			threadCount = std::max<size_t>(1, threadCount);
+
+			for (size_t i = 0; i < threadCount; i++)
+				m_queues.push_back(std::make_unique<Queue>());
+			for (size_t i = 0; i < threadCount; i++)
+				m_threads.emplace_back([this, i] { WorkerLoop(i); });
+		}
+
+		~ThreadPool() {
+			{
+				std::lock_guard<std::mutex> lock{ m_sleepMutex };
+				m_stop = true;
+			}
+			m_wake.notify_all();
+
+			for (std::thread& thread : m_threads)
+				thread.join();
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void Submit(Task task) {
+			size_t queue = (t_pool == this) ? t_workerIndex : m_nextQueue++ % m_queues.size();
+
+			{
+				std::lock_guard<std::mutex> lock{ m_queues[queue]->mutex };
+				m_queues[queue]->tasks.push_back(std::move(task));
+			}
+
+			{
+				// Taking the sleep lock prevents a worker from missing the wakeup
+				// between checking the counter and going to sleep.
+				std::lock_guard<std::mutex> lock{ m_sleepMutex };
+				m_queuedTasks++;
+			}
+			m_wake.notify_one();
+		}
+
+		size_t ThreadCount() const {
+			return m_threads.size();
+		}
+
+		/*
+		*  Calls func(i) for every i < count across the pool, returning once all calls finished.
+		*  The calling thread works through indices too, so this can be called from inside a task.
+		*/
+		template <typename Func>
+		void ParallelFor(size_t count, const Func& func) {
+			if (count == 0) return;
+
+			struct State {
+				std::atomic<size_t> next{ 0 };
+				std::atomic<size_t> finished{ 0 };
+				std::mutex mutex;
+				std::condition_variable done;
+			};
+
+			// Helpers can start after everything is done, they only touch func while indices remain
+			auto state = std::make_shared<State>();
+			auto work = [state, count, &func] {
+				for (size_t i = state->next++; i < count; i = state->next++) {
+					func(i);
+					if (++state->finished == count) {
+						std::lock_guard<std::mutex> lock{ state->mutex };
+						state->done.notify_all();
+					}
+				}
+			};
+
+			size_t helpers = std::min(count, m_threads.size()) - 1;
+			for (size_t i = 0; i < helpers; i++)
+				Submit(work);
+			work();
+
+			std::unique_lock<std::mutex> lock{ state->mutex };
+			state->done.wait(lock, [&state, count] { return state->finished == count; });
+		}
+
+	};
+
+
+
+	inline uint64_t ECS::Hash(ThreadPool& threads) {
+		return ComputeHash([&threads](size_t count, const auto& task) {
+			threads.ParallelFor(count, task);
+		});
+	}
+
+	inline uint64_t ECS::Checksum(ThreadPool& threads) {
+		return ChecksumFrom(Hash(threads));
+	}
+
+
+
+	// Candidates per ParallelReduce() chunk, fixed so results don't depend on the thread count
+	constexpr size_t REDUCE_CHUNK = 4096;
+
+	/*
+	*  Reduces a read-only view in parallel. Every chunk of the view is folded on its own,
+	*  starting from identity with func(T& accumulator, components...), and the chunk
+	*  results are then combined in chunk order, on the calling thread:
+	*
+	*    float energy = ParallelReduce(threads, ecs.View<const Physics>(), 0.0f,
+	*        [](float& sum, const Physics& p) { sum += 0.5f * p.mass * p.speed * p.speed; },
+	*        [](float a, float b) { return a + b; });
+	*
+	*  Chunking only depends on the view, so even floating point results are bit-identical
+	*  regardless of thread count and scheduling. func also accepts the EntityID first.
+	*/
+	template <typename T, typename Func, typename Combine, typename... Components>
+	T ParallelReduce(ThreadPool& threads, SimpleView<Components...> view, T identity, Func func, Combine combine) {
+		static_assert((std::is_const_v<Components> && ...), "ParallelReduce only takes views of const components");
+
+		size_t chunkCount = (view.CandidateCount() + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+		std::vector<T> partials(chunkCount, identity);
+
+		threads.ParallelFor(chunkCount, [&](size_t chunk) {
+			T& accumulator = partials[chunk];
+			size_t begin = chunk * REDUCE_CHUNK;
+
+			if constexpr (std::is_invocable_v<Func&, T&, EntityID, Components&...>) {
+				view.ForEachInRange(begin, begin + REDUCE_CHUNK, [&](EntityID id, Components&... components) {
+					func(accumulator, id, components...);
+				});
+			}
+			else {
+				view.ForEachInRange(begin, begin + REDUCE_CHUNK, [&](Components&... components) {
+					func(accumulator, components...);
+				});
+			}
+		});
+
+		T result = identity;
+		for (T& partial : partials)
+			result = combine(result, partial);
+		return result;
+	}
+
+
+
+	/*
+	*  Runs systems on a ThreadPool, in parallel wherever their declared component access allows it.
+	*
+	*  Access is declared with the same pack you'd pass to ECS::View(), const meaning read-only.
+	*  The system either takes the ECS, or a view over exactly the declared components:
+	*
+	*    scheduler.AddSystem<Transform, const Physics>("Move", [](SimpleView<Transform, const Physics>& view) {
+	*        view.ForEach([](Transform& t, const Physics& p) { ... });
+	*    });
+	*
+	*  Resources are declared as Res<T>/Res<const T>, and are left out of the view.
+	*  Systems using them take the ECS as well to reach them:
+	*
+	*    scheduler.AddSystem<Transform, Res<const Time>>("Move", [](SimpleView<Transform>& view, ECS& ecs) {
+	*        float dt = ecs.Resource<const Time>().delta;
+	*        ...
+	*    });
+	*
+	*  Resources have to be set before Run(), setting them while systems run isn't thread safe.
+	*
+	*  Any number of systems reading a component run concurrently, since const views never
+	*  write to their pools, while a system writing to it waits for them (and vice versa).
+	*
+	*  A system depends on every system added before it that writes something it reads or writes,
+	*  or reads something it writes. Conflicting systems therefore always run in the order they were
+	*  added, which keeps results deterministic as long as systems only touch what they declare.
+	*  Systems must not create/delete entities or add/remove components while running in parallel.
+	*/
+	class Scheduler {
+	public:
+
+		struct SystemTiming {
+			std::string name;
+			double lastSeconds = 0.0;
+			double totalSeconds = 0.0;
+			size_t runs = 0;
+		};
+
+	private:
+
+		using Clock = std::chrono::steady_clock;
+
+		struct System {
+			std::string name;
+			std::function<void(ECS&)> func;
+
+			std::vector<std::type_index> reads;
+			std::vector<std::type_index> writes;
+
+			std::vector<size_t> dependents;
+			size_t dependencyCount = 0;
+
+			std::atomic<size_t> remainingDependencies{ 0 };
+			SystemTiming timing;
+		};
+
+		ECS& m_ecs;
+		ThreadPool m_pool;
+		std::vector<std::unique_ptr<System>> m_systems;
+
+		std::mutex m_doneMutex;
+		std::condition_variable m_done;
+		size_t m_remainingSystems = 0;
+
+		template <typename Access>
+		struct AccessTraits {
+			using Type = Access;
+		};
+
+		template <typename T>
+		struct AccessTraits<Res<T>> {
+			using Type = T;
+		};
+
+		template <typename Access>
+		static void DeclareAccess(System& system) {
+			using Accessed = typename AccessTraits<Access>::Type;
+
+			// Resources are tracked under Res<T>, so they never collide with a component T
+			using Key = std::conditional_t<is_resource_access<Access>::value,
+				Res<std::remove_const_t<Accessed>>, std::remove_const_t<Accessed>>;
+
+			if constexpr (std::is_const_v<Accessed>)
+				system.reads.push_back(typeid(Key));
+			else
+				system.writes.push_back(typeid(Key));
+		}
+
+		template <typename... Components>
+		static SimpleView<Components...> MakeView(ECS& ecs, SimpleView<Components...>*) {
+			return ecs.View<Components...>();
+		}
+
+		template <typename... Components>
+		static void RegisterViewComponents(ECS& ecs, SimpleView<Components...>*) {
+			// Pools are created lazily, which would race once systems run in parallel
+			ecs.RegisterComponents<std::remove_const_t<Components>...>();
+		}
+
+		static bool Overlaps(const std::vector<std::type_index>& a, const std::vector<std::type_index>& b) {
+			return std::any_of(a.begin(), a.end(), [&b](const std::type_index& type) {
+				return std::find(b.begin(), b.end(), type) != b.end();
+			});
+		}
+
+		static bool Conflicts(const System& a, const System& b) {
+			return Overlaps(a.writes, b.writes) || Overlaps(a.writes, b.reads) || Overlaps(a.reads, b.writes);
+		}
+
+		void Execute(System& system) {
+			Clock::time_point start = Clock::now();
+			system.func(m_ecs);
+			double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+			system.timing.lastSeconds = elapsed;
+			system.timing.totalSeconds += elapsed;
+			system.timing.runs++;
+		}
+
+		void RunTask(System& system) {
+			Execute(system);
+
+			for (size_t dependent : system.dependents) {
+				System& next = *m_systems[dependent];
+				if (--next.remainingDependencies == 0)
+					m_pool.Submit([this, &next] { RunTask(next); });
+			}
+
+			std::lock_guard<std::mutex> lock{ m_doneMutex };
+			if (--m_remainingSystems == 0)
+				m_done.notify_all();
+		}
+
+	public:
+
+		Scheduler(ECS& ecs, size_t threadCount = std::thread::hardware_concurrency()) :
+			m_ecs{ ecs },
+			m_pool{ threadCount }
+		{}
+
+		/*
+		*  Adds a system, see the class comment for how Access is declared.
+		*  Systems have to be added from the thread calling Run().
+		*/
+		template <typename... Access, typename Func>
+		void AddSystem(std::string name, Func func) {
+			auto system = std::make_unique<System>();
+			system->name = name;
+			system->timing.name = name;
+			(DeclareAccess<Access>(*system), ...);
+
+			using View = typename component_view<SimpleView<>, Access...>::type;
+
+			if constexpr (std::is_invocable_v<Func, View&>) {
+				system->func = [func](ECS& ecs) mutable {
+					View view = MakeView(ecs, static_cast<View*>(nullptr));
+					func(view);
+				};
+			}
+			else if constexpr (std::is_invocable_v<Func, View&, ECS&>) {
+				system->func = [func](ECS& ecs) mutable {
+					View view = MakeView(ecs, static_cast<View*>(nullptr));
+					func(view, ecs);
+				};
+			}
+			else {
+				static_assert(std::is_invocable_v<Func, ECS&>,
+					"Systems must take ECS&, a SimpleView of the declared components, or both");
+				system->func = func;
+			}
+
+			RegisterViewComponents(m_ecs, static_cast<View*>(nullptr));
+
+			size_t index = m_systems.size();
+			for (size_t i = 0; i < index; i++) {
+				if (Conflicts(*m_systems[i], *system)) {
+					m_systems[i]->dependents.push_back(index);
+					system->dependencyCount++;
+				}
+			}
+
+			m_systems.push_back(std::move(system));
+		}
+
+		/*
+		*  Runs every system once, blocking until all of them finished.
+		*/
+		void Run() {
+			if (m_systems.empty()) return;
+
+			m_remainingSystems = m_systems.size();
+			for (auto& system : m_systems)
+				system->remainingDependencies = system->dependencyCount;
+
+			for (auto& system : m_systems) {
+				if (system->dependencyCount == 0) {
+					System* root = system.get();
+					m_pool.Submit([this, root] { RunTask(*root); });
+				}
+			}
+
+			std::unique_lock<std::mutex> lock{ m_doneMutex };
+			m_done.wait(lock, [this] { return m_remainingSystems == 0; });
+		}
+
+		/*
+		*  Runs every system once on the calling thread, in the order they were added.
+		*  Useful for debugging, or to get identical ordering even for systems that
+		*  access more than they declare.
+		*/
+		void RunSequential() {
+			for (auto& system : m_systems)
+				Execute(*system);
+		}
+
+		std::vector<SystemTiming> GetTimings() const {
+			std::vector<SystemTiming> timings;
+			for (const auto& system : m_systems)
+				timings.push_back(system->timing);
+			return timings;
+		}
+
+		void PrintTimings() const {
+			for (const auto& system : m_systems)
+				SEECS_MSG(system->name << ": " << system->timing.lastSeconds * 1e3 << "ms (avg "
+					<< (system->timing.runs ? system->timing.totalSeconds / system->timing.runs * 1e3 : 0.0) << "ms)");
+		}
+
+	};
+
+}
+
+#endif
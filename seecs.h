@@ -11,10 +11,25 @@
 #include <algorithm>
 #include <bitset>
 #include <memory>
+#include <memory_resource>
 #include <type_traits>
 #include <typeindex>
 #include <functional>
 #include <typeinfo>
+#include <cstring>
+#include <new>
+#include <atomic>
+#include <utility>
+#include <set>
+#include <deque>
+#include <string_view>
+#include <mutex>
+
+#if defined(__linux__)
+	#include <sys/mman.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
 
 // Can replace these defines with custom macros elsewhere
 #ifndef SEECS_ASSERT
@@ -48,14 +63,204 @@ namespace seecs {
 	// Set this to NULL_ENTITY if you want no limit.
 	// Once limit is hit, an assert will fire and
 	// the program will terminate.
+	// ECS::SetEntityCapacity() sets a limit per world instead.
 	constexpr size_t MAX_ENTITIES = NULL_ENTITY;
 
 
+	// Error codes of the Try* functions, see ECS::SetEntityCapacity()
+	enum class Result : uint8_t {
+		Ok,
+		EntityLimit,  // No free ID left below the entity capacity
+		PoolFull      // The component's pool is at capacity
+	};
+
+
 	// Should be a multiple of 32 (4 bytes), since
 	// bitset overallocates by 4 bytes each time.
 	constexpr size_t MAX_COMPONENTS = 64;
 
 
+	// Size of a single page for components using paged dense storage,
+	// see paged_storage below.
+	constexpr size_t DENSE_PAGE_BYTES = 16384;
+
+
+	// Dirty regions of a dense array are tracked in blocks of this many bytes,
+	// which is the granularity delta snapshots are written at.
+	constexpr size_t DIRTY_BLOCK_BYTES = 4096;
+
+
+	// Max amount of threads emitting events at once with a writer of their own, see ECS::Emit().
+	// Each event type keeps a cache line sized writer for every one of them, threads past
+	// that share one more writer behind a lock. Writers of exited threads are reused.
+	constexpr size_t MAX_EVENT_WRITERS = 64;
+
+
+	// Size of the huge pages HugePageResource maps, 2 MB on x86-64 and most ARM64 kernels.
+	constexpr size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+
+	/*
+	*  Flat byte buffer used to serialize world state. Only trivially copyable
+	*  values can be written, everything is stored in native byte order.
+	*/
+	class SnapshotWriter {
+	private:
+
+		std::vector<uint8_t>& m_bytes;
+
+	public:
+
+		SnapshotWriter(std::vector<uint8_t>& bytes) :
+			m_bytes{ bytes }
+		{}
+
+		void WriteBytes(const void* data, size_t size) {
+			const uint8_t* begin = static_cast<const uint8_t*>(data);
+			m_bytes.insert(m_bytes.end(), begin, begin + size);
+		}
+
+		template <typename T>
+		void Write(const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written");
+			WriteBytes(&value, sizeof(T));
+		}
+
+		// 7 bits per byte, so small values (IDs, counts) take a single byte
+		void WriteVarint(uint64_t value) {
+			while (value >= 0x80) {
+				m_bytes.push_back(static_cast<uint8_t>(value) | 0x80);
+				value >>= 7;
+			}
+			m_bytes.push_back(static_cast<uint8_t>(value));
+		}
+
+	};
+
+	class SnapshotReader {
+	private:
+
+		const std::vector<uint8_t>& m_bytes;
+		size_t m_offset = 0;
+
+	public:
+
+		SnapshotReader(const std::vector<uint8_t>& bytes) :
+			m_bytes{ bytes }
+		{}
+
+		void ReadBytes(void* data, size_t size) {
+			if (size == 0) return;
+			SEECS_ASSERT(m_offset + size <= m_bytes.size(), "Snapshot read out of bounds, data is truncated or corrupt");
+			std::memcpy(data, m_bytes.data() + m_offset, size);
+			m_offset += size;
+		}
+
+		template <typename T>
+		T Read() {
+			static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read");
+			T value;
+			ReadBytes(&value, sizeof(T));
+			return value;
+		}
+
+		uint64_t ReadVarint() {
+			uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				uint8_t byte = Read<uint8_t>();
+				value |= uint64_t(byte & 0x7f) << shift;
+				if (!(byte & 0x80))
+					return value;
+			}
+			SEECS_ASSERT(false, "Malformed varint, data is truncated or corrupt");
+			return value;
+		}
+
+		bool AtEnd() const {
+			return m_offset == m_bytes.size();
+		}
+
+	};
+
+
+
+	// Final mix of splitmix64, spreads every input bit over the whole result
+	inline uint64_t HashMix(uint64_t x) {
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ull;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebull;
+		x ^= x >> 31;
+		return x;
+	}
+
+	// Hashes raw bytes, 8 at a time. Padding bytes are hashed too, so they must be initialized.
+	inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		uint64_t hash = seed ^ (size * 0x9e3779b97f4a7c15ull);
+
+		for (; size >= 8; bytes += 8, size -= 8) {
+			uint64_t word;
+			std::memcpy(&word, bytes, 8);
+			hash = HashMix(hash ^ word);
+		}
+		if (size > 0) {
+			uint64_t word = 0;
+			std::memcpy(&word, bytes, size);
+			hash = HashMix(hash ^ word);
+		}
+		return hash;
+	}
+
+	// Secret the words of a component are keyed with, taken from XXH3
+	constexpr uint64_t HASH_SECRET[4] = {
+		0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull
+	};
+
+	/*
+	*  XXH3-style hash of a fixed number of bytes. Each 8-byte word is keyed and folded in with
+	*  a 32x32->64 bit multiply, which SIMD units have (unlike full 64-bit multiplies), so loops
+	*  hashing many small components at once auto-vectorize.
+	*/
+	template <size_t Size>
+	inline uint64_t HashFixed(const void* data, uint64_t seed) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		uint64_t accumulator = seed * 0x9e3779b185ebca87ull + Size;
+
+		for (size_t offset = 0; offset < Size; offset += 8) {
+			uint64_t word = 0;
+			std::memcpy(&word, bytes + offset, std::min<size_t>(8, Size - offset));
+
+			uint64_t keyed = word ^ (HASH_SECRET[(offset / 8) % 4] + seed);
+			accumulator += (keyed & 0xffffffff) * (keyed >> 32);
+			accumulator += word;
+		}
+
+		// XXH3 avalanche
+		accumulator ^= accumulator >> 37;
+		accumulator *= 0x165667919e3779f9ull;
+		accumulator ^= accumulator >> 32;
+		return accumulator;
+	}
+
+	/*
+	*  Hash of one component of an entity, used for world hashes. Trivially copyable
+	*  components are hashed by their bytes, others through std::hash when it exists.
+	*  Anything else only contributes the entity ID.
+	*/
+	template <typename T>
+	uint64_t HashComponent(EntityID id, const T& component) {
+		if constexpr (std::is_empty_v<T>)
+			return HashMix(id);
+		else if constexpr (std::is_trivially_copyable_v<T>)
+			return HashFixed<sizeof(T)>(&component, id);
+		else if constexpr (std::is_default_constructible_v<std::hash<T>>)
+			return HashMix(id ^ HashMix(std::hash<T>{}(component)));
+		else
+			return HashMix(id);
+	}
+
+
 	// Base class allows runtime polymorphism
 	class ISparseSet {
 	public:
@@ -65,6 +270,32 @@ namespace seecs {
 		virtual size_t Size() = 0;
 		virtual bool ContainsEntity(EntityID id) = 0;
 		virtual std::vector<EntityID> GetEntityList() = 0;
+
+		// Preallocates room for count components of entities below an ID, see SparseSetBase::Reserve()
+		virtual void Reserve(size_t count, size_t entities) = 0;
+		virtual size_t Capacity() const = 0;
+
+		// Snapshot support, see SparseSet for the details
+		virtual uint64_t AdvanceEpoch() = 0;
+		virtual void Serialize(SnapshotWriter& writer, uint64_t sinceEpoch) = 0;
+		virtual void Deserialize(SnapshotReader& reader) = 0;
+
+		// Copies the component of source to count entities that don't have one yet, see ECS::Clone()
+		virtual void CloneComponent(EntityID source, const EntityID* targets, size_t count) = 0;
+
+		// Order-independent hash of count components from a dense index on, see SparseSetBase::Hash().
+		// Hashes are summed, so hashing a set in parts and adding them up gives the same result.
+		virtual uint64_t HashRange(size_t start, size_t count) const = 0;
+
+		// Copies of the whole set, see ECS::Fork(). Clone() allocates the copy from the given resource,
+		// CopyFrom() takes a set of the same type and reuses this set's allocations.
+		virtual std::unique_ptr<ISparseSet> Clone(std::pmr::memory_resource* resource) const = 0;
+		virtual void CopyFrom(const ISparseSet& other) = 0;
+
+		// Trace support, see ECS::StartRecording(). Sets a component from traced_size_v<T> raw
+		// bytes, or a default constructed one when bytes is null.
+		virtual size_t TracedSize() const = 0;
+		virtual void SetTraced(EntityID id, const void* bytes) = 0;
 	};
 
 
@@ -87,613 +318,4688 @@ namespace seecs {
 
 
 	/*
-	*  A templated sparse set implementation, mapping EntityID -> T
-	* 
-	*  - Get(EntityID): returns T or NULL if EntityID is not in sparse set
-	*  - Set(EntityID, T&&): Adds/Overwrites into the dense list for the specified entity
-	*  - Delete(EntityID): Removes data for EntityID from dense list
+	*  Opt-in trait selecting PagedVector as the dense storage for a component:
+	*
+	*    template <> struct seecs::paged_storage<Transform> : std::true_type {};
+	*
+	*  Growing the pool never moves existing elements, so references/pointers to paged components
+	*  survive adding components. Removing any component of the pool (which moves the last one into
+	*  the hole), sorting it, SetPoolMemoryResource() and ECS::Fork() (after which pages are
+	*  copied on their first write) still invalidate them, so fetch components again after those.
+	*
+	*  Paged pools are shared copy-on-write between forks, which is what large worlds
+	*  forked every frame want.
 	*/
 	template <typename T>
-	class SparseSet: public ISparseSet {
-	private:
+	struct paged_storage : std::false_type {};
 
-		static constexpr size_t SPARSE_MAX_SIZE = 2048;
-		static constexpr size_t tombstone = std::numeric_limits<size_t>::max();
 
-		using Sparse = std::array<size_t, SPARSE_MAX_SIZE>;
 
-		std::vector<Sparse> m_sparsePages;
+	/*
+	*  Vector-like container storing its elements in fixed-size pages of DENSE_PAGE_BYTES.
+	*  Pages are allocated as the container grows and kept around when it shrinks, so
+	*  elements never move and growth never copies anything besides the page table.
+	*
+	*  Pages are reference counted and copy-on-write: copying a PagedVector only copies
+	*  the page table, and a page is duplicated the first time either copy writes to it.
+	*  Any mutable access counts as a write, const access never copies.
+	*/
+	template <typename T>
+	class PagedVector {
+	public:
 
-		std::vector<T> m_dense;
-		std::vector<EntityID> m_denseToEntity; // 1:1 vector where dense index == Entity Index
+		static constexpr size_t PAGE_SIZE = std::max<size_t>(1, DENSE_PAGE_BYTES / sizeof(T));
 
-		/*
-		* Inserts a given dense index into the sparse vector, associating
-		* an Entity ID with the index in the dense vector.
-		*
-		* This doesnt actually insert anything into the dense
-		* vector, it simply defines a mapping from ID -> index
-		*/
-		inline void SetDenseIndex(EntityID id, size_t index) {
-			size_t page = id / SPARSE_MAX_SIZE;
-			size_t sparseIndex = id % SPARSE_MAX_SIZE; // Index local to a page
+	private:
 
-			if (page >= m_sparsePages.size()) {
-				m_sparsePages.resize(page + 1);
-				m_sparsePages[page].fill(tombstone);
+		struct Page {
+			alignas(T) unsigned char storage[PAGE_SIZE * sizeof(T)];
+
+			// Elements constructed in this page, a shared page can be ahead of
+			// the size of some of the vectors sharing it.
+			size_t count = 0;
+
+			T* Slot(size_t index) {
+				return std::launder(reinterpret_cast<T*>(storage) + index);
 			}
 
-			Sparse& sparse = m_sparsePages[page];
+			const T* Slot(size_t index) const {
+				return std::launder(reinterpret_cast<const T*>(storage) + index);
+			}
 
-			sparse[sparseIndex] = index;
-		}
+			Page() = default;
 
-		/*
-		* Returns the dense index for a given entity ID,
-		* or a tombstone (null) value if non-existent
-		*/
-		inline size_t GetDenseIndex(EntityID id) {
-			size_t page = id / SPARSE_MAX_SIZE;
-			size_t sparseIndex = id % SPARSE_MAX_SIZE;
+			Page(const Page& other) {
+				if constexpr (std::is_trivially_copyable_v<T>) {
+					std::memcpy(storage, other.storage, other.count * sizeof(T));
+				}
+				else {
+					for (size_t i = 0; i < other.count; i++)
+						new (Slot(i)) T(*other.Slot(i));
+				}
+				count = other.count;
+			}
 
-			if (page < m_sparsePages.size()) {
-				Sparse& sparse = m_sparsePages[page];
-				return sparse[sparseIndex];
+			~Page() {
+				Truncate(0);
 			}
 
-			return tombstone;
+			void Truncate(size_t size) {
+				while (count > size)
+					Slot(--count)->~T();
+			}
+		};
+
+		// Pages and the page table are allocated from here, see ECS::ECS(memory_resource*)
+		std::pmr::memory_resource* m_resource = std::pmr::get_default_resource();
+
+		std::pmr::vector<std::shared_ptr<Page>> m_pages{ m_resource };
+		size_t m_size = 0;
+
+		template <typename... Args>
+		std::shared_ptr<Page> NewPage(Args&&... args) {
+			return std::allocate_shared<Page>(std::pmr::polymorphic_allocator<Page>{ m_resource }, std::forward<Args>(args)...);
 		}
 
-	public:
+		const T* Slot(size_t index) const {
+			return m_pages[index / PAGE_SIZE]->Slot(index % PAGE_SIZE);
+		}
 
-		SparseSet() {
-			// Avoids initial copies/allocation, feel free to alter size
-			m_dense.reserve(1000);
-			m_denseToEntity.reserve(1000);
+		T* Slot(size_t index) {
+			return WritablePage(index / PAGE_SIZE).Slot(index % PAGE_SIZE);
 		}
 
-		T* Set(EntityID id, T obj) {
-			// Overwrite existing elements
-			size_t index = GetDenseIndex(id);
-			if (index != tombstone) {
-				m_dense[index] = obj;
-				m_denseToEntity[index] = id;
+		// Unshares a page before it gets written to
+		Page& WritablePage(size_t page) {
+			std::shared_ptr<Page>& shared = m_pages[page];
+			if (shared.use_count() > 1)
+				shared = NewPage(*shared);
+			return *shared;
+		}
 
-				return &m_dense[index];
-			}
+		void EnsurePage(size_t index) {
+			while (index / PAGE_SIZE >= m_pages.size())
+				m_pages.push_back(NewPage());
+		}
 
-			// New index will be the back of the dense list
-			SetDenseIndex(id, m_dense.size());
+	public:
 
-			m_dense.push_back(obj);
-			m_denseToEntity.push_back(id);
+		PagedVector() = default;
 
-			return &m_dense.back();
-		}
+		explicit PagedVector(std::pmr::memory_resource* resource) :
+			m_resource{ resource }
+		{}
 
-		T* Get(EntityID id) {
-			size_t index = GetDenseIndex(id);
-			return (index != tombstone) ? &m_dense[index] : nullptr;
+		PagedVector(const PagedVector& other) :
+			m_resource{ other.m_resource }
+		{
+			*this = other;
 		}
 
-		T& GetRef(EntityID id) {
-			size_t index = GetDenseIndex(id);
-			if (index == tombstone)
-				SEECS_ASSERT(false, "GetRef called on invalid entity with ID " << id);
-			return m_dense[index];
-		}
+		// Takes the pages along with their resource, other is left empty
+		PagedVector(PagedVector&& other) noexcept :
+			m_resource{ other.m_resource },
+			m_pages{ std::move(other.m_pages) },
+			m_size{ std::exchange(other.m_size, 0) }
+		{}
 
-		void Delete(EntityID id) override {
+		// Shares every page with other, nothing is copied until one of them writes.
+		// Pages from another memory resource are copied right away instead.
+		PagedVector& operator=(const PagedVector& other) {
+			if (this == &other) return *this;
 
-			size_t deletedIndex = GetDenseIndex(id);
+			if (m_resource->is_equal(*other.m_resource)) {
+				m_pages = other.m_pages;
+			}
+			else {
+				m_pages.clear();
+				for (const std::shared_ptr<Page>& page : other.m_pages)
+					m_pages.push_back(NewPage(*page));
+			}
 
-			if (m_dense.empty() || deletedIndex == tombstone) return;
+			m_size = other.m_size;
+			return *this;
+		}
 
-			SetDenseIndex(m_denseToEntity.back(), deletedIndex);
-			SetDenseIndex(id, tombstone);
+		T& operator[](size_t index) { return *Slot(index); }
+		const T& operator[](size_t index) const { return *Slot(index); }
 
-			std::swap(m_dense.back(), m_dense[deletedIndex]);
-			std::swap(m_denseToEntity.back(), m_denseToEntity[deletedIndex]);
+		T& back() { return *Slot(m_size - 1); }
+		const T& back() const { return *Slot(m_size - 1); }
 
-			m_dense.pop_back();
-			m_denseToEntity.pop_back();
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		void reserve(size_t count) {
+			if (count > 0)
+				EnsurePage(count - 1);
 		}
 
-		size_t Size() override {
-			return m_dense.size();
+		// Copies the pages shared with other vectors up front, so writes don't allocate
+		void Unshare() {
+			for (size_t page = 0; page < m_pages.size(); page++)
+				WritablePage(page);
 		}
 
-		std::vector<EntityID> GetEntityList() override {
-			return m_denseToEntity;
+		void push_back(const T& value) {
+			EnsurePage(m_size);
+			Page& page = WritablePage(m_size / PAGE_SIZE);
+			new (page.Slot(m_size % PAGE_SIZE)) T(value);
+			page.count++;
+			m_size++;
 		}
 
-		bool ContainsEntity(EntityID id) override {
-			return GetDenseIndex(id) != tombstone;
+		void push_back(T&& value) {
+			EnsurePage(m_size);
+			Page& page = WritablePage(m_size / PAGE_SIZE);
+			new (page.Slot(m_size % PAGE_SIZE)) T(std::move(value));
+			page.count++;
+			m_size++;
 		}
 
-		void Clear() override {
-			m_dense.clear();
-			m_sparsePages.clear();
-			m_denseToEntity.clear();
+		void pop_back() {
+			m_size--;
+			WritablePage(m_size / PAGE_SIZE).Truncate(m_size % PAGE_SIZE);
 		}
 
-		bool IsEmpty() const {
-			return m_dense.empty();
+		void clear() {
+			// Shared pages are swapped for empty ones rather than copied just to be emptied
+			for (std::shared_ptr<Page>& page : m_pages) {
+				if (page.use_count() > 1)
+					page = NewPage();
+				else
+					page->Truncate(0);
+			}
+			m_size = 0;
 		}
 
-		// Read-only dense list
-		const std::vector<T>& Data() const {
-			return m_dense;
+		// Number of pages this vector shares with copies of it, mostly for diagnostics
+		size_t SharedPageCount() const {
+			return std::count_if(m_pages.begin(), m_pages.end(),
+				[](const std::shared_ptr<Page>& page) { return page.use_count() > 1; });
 		}
 
-		void PrintDense() {
-			std::stringstream ss;
-			std::string delim = "";
-			for (const T& e : m_dense) {
-				ss << delim << e;
-				if (delim.empty())
-					delim = ", ";
-			}
-			SEECS_INFO("[" << ss.str() << "]");
+		// Number of elements stored contiguously starting at index
+		size_t ContiguousRun(size_t index) const {
+			return std::min(m_size - index, PAGE_SIZE - index % PAGE_SIZE);
 		}
 
+		template <typename Value, typename Container>
+		class Iterator {
+		private:
+			Container* m_container;
+			size_t m_index;
+		public:
+			Iterator(Container* container, size_t index) : m_container{ container }, m_index{ index } {}
+			Value& operator*() const { return (*m_container)[m_index]; }
+			Iterator& operator++() { m_index++; return *this; }
+			bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+		};
+
+		Iterator<T, PagedVector> begin() { return { this, 0 }; }
+		Iterator<T, PagedVector> end() { return { this, m_size }; }
+		Iterator<const T, const PagedVector> begin() const { return { this, 0 }; }
+		Iterator<const T, const PagedVector> end() const { return { this, m_size }; }
+
 	};
 
+	// Number of elements stored contiguously in a vector starting at index
+	template <typename T, typename Allocator>
+	size_t ContiguousRun(const std::vector<T, Allocator>& vector, size_t index) {
+		return vector.size() - index;
+	}
+
+	template <typename T>
+	size_t ContiguousRun(const PagedVector<T>& vector, size_t index) {
+		return vector.ContiguousRun(index);
+	}
+
 
 
 	/*
-	*  A SimpleView is a basic implementation of a view, allowing iteration based
-	*  on the passed in Component parameter pack.
+	*  Dense "storage" for empty (tag) components, e.g struct Enemy {};
+	*  Only counts elements, every index refers to the same instance since
+	*  there's nothing to tell them apart. Pools of tags therefore cost no
+	*  component memory, just the entity list.
 	*/
-	template <typename... Components>
-	class SimpleView {
+	template <typename T>
+	class TagStorage {
 	private:
 
-		using componentTypes = type_list<Components...>;
+		static_assert(std::is_empty_v<T>, "TagStorage is only for empty types");
 
-		std::array<ISparseSet*, sizeof...(Components)> m_viewPools;
+		T m_tag{};
+		size_t m_size = 0;
 
-		// Sparse set with the smallest number of components,
-		// basis for ForEach iterations.
-		ISparseSet* m_smallest = nullptr;
+	public:
 
-		/*
-		*	Returns true iff all the pools in the view contain the given Entity
-		*/
-		bool AllContain(EntityID id) {
-			return std::all_of(m_viewPools.begin(), m_viewPools.end(), [id](ISparseSet* pool) {
-				return pool->ContainsEntity(id);
-			});
-		}
+		using value_type = T;
 
-		/*
-		*	Index the generic pool array and downcast to a specific component pool
-		*   by using compile time indices
-		*/
-		template <size_t Index>
-		auto GetPoolAt() {
-			using componentType = typename componentTypes::template get<Index>;
-			return static_cast<SparseSet<componentType>*>(m_viewPools[Index]);
-		}
+		void push_back(const T&) { m_size++; }
+		void pop_back() { m_size--; }
 
-		template <size_t... Indices>
-		auto MakeComponentTuple(EntityID id, std::index_sequence<Indices...>) {
-			return std::make_tuple((std::ref(GetPoolAt<Indices>()->GetRef(id)))...);
-		}
+		T& operator[](size_t) { return m_tag; }
+		const T& operator[](size_t) const { return m_tag; }
 
-		/*
-		*  Provided the function arguments are valid, this function will iterate over the smallest pool
-		*  and run the lambda on all entities that contain all the components in the view.
-		* 
-		*  Note: This is the internal implementation: opt for the more user friendly functional ones in the
-		*        public interface.
-		*/
-		template <typename Func>
-		void ForEachImpl(Func func) {
-			constexpr auto inds = std::make_index_sequence<sizeof...(Components)>{};
+		T& back() { return m_tag; }
 
-			// Iterate smallest component pool and compare against other pools in view
-			// Note this list is a COPY, allowing safe deletion during iteration.
-			for (EntityID id : m_smallest->GetEntityList()) {
-				if (AllContain(id)) {
-
-					// This branch is for [](EntityID id, Component& c1, Component& c2);
-					// constexpr denotes this is evaluated at compile time, which prunes
-					// invalid function call branches before runtime to prevent the
-					// typical invoke errors you'd see after building.
-					if constexpr (std::is_invocable_v<Func, EntityID, Components&...>) {
-						std::apply(func, std::tuple_cat(std::make_tuple(id), MakeComponentTuple(id, inds)));
-					}
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+		void reserve(size_t) {}
+		void clear() { m_size = 0; }
+	};
 
-					// This branch is for [](Component& c1, Component& c2);
-					else if constexpr (std::is_invocable_v<Func, Components&...>) {
-						std::apply(func, MakeComponentTuple(id, inds));
-					}
+	// Tags have no data, so any run is as long as the rest of the pool
+	template <typename T>
+	size_t ContiguousRun(const TagStorage<T>& storage, size_t index) {
+		return storage.size() - index;
+	}
 
-					else {
-						SEECS_ASSERT(false,
-							"Bad lambda provided to .ForEach(), parameter pack does not match lambda args");
-					}
-				}
-			}
-		}
+	template <typename T>
+	inline constexpr bool is_tag_v = std::is_empty_v<std::remove_const_t<T>>;
 
-	public:
+	// Bytes a component takes up in a Trace, the rest replay default constructed
+	template <typename T>
+	inline constexpr size_t traced_size_v = (is_tag_v<T> || !std::is_trivially_copyable_v<T>) ? 0 : sizeof(T);
 
-		// These are the function signatures you can pass to .ForEach()
-		using ForEachFunc = std::function<void(Components&...)>;
-		using ForEachFuncWithID = std::function<void(EntityID, Components&...)>;
+	// is_invocable_v for the element types of a std::tuple
+	template <typename Func, typename Tuple>
+	struct is_applicable;
 
-		SimpleView(std::array<ISparseSet*, sizeof...(Components)> pools) :
-			m_viewPools{ pools }
-		{
-			SEECS_ASSERT(componentTypes::size == m_viewPools.size(), "Component type list and pool array size mismatch");
+	template <typename Func, typename... Ts>
+	struct is_applicable<Func, std::tuple<Ts...>> : std::is_invocable<Func, Ts...> {};
 
-			auto smallestPool = std::min_element(m_viewPools.begin(), m_viewPools.end(),
-				[](ISparseSet* a, ISparseSet* b) { return a->Size() < b->Size(); }
-			);
+	template <typename Func, typename Tuple>
+	inline constexpr bool is_applicable_v = is_applicable<Func, Tuple>::value;
+
+
+
+	/*
+	*  Non-owning view over a contiguous run of elements
+	*/
+	template <typename T>
+	struct Span {
+		T* data = nullptr;
+		size_t size = 0;
+
+		T& operator[](size_t index) const { return data[index]; }
+		T* begin() const { return data; }
+		T* end() const { return data + size; }
+		bool empty() const { return size == 0; }
+	};
+
+
+
+	/*
+	*  Shared bookkeeping for every pool: the paged EntityID -> dense index mapping,
+	*  the dense index -> EntityID list and dirty block tracking.
+	*
+	*  Derived pools own the actual component data and keep it in the same
+	*  order as m_denseToEntity.
+	* 
+	*  Every write access stamps the block of the dense list it touches with the
+	*  current epoch, so consumers like delta snapshots can find what changed since
+	*  they last looked by calling AdvanceEpoch() and remembering the result.
+	*/
+	class SparseSetBase : public ISparseSet {
+	protected:
+
+		static constexpr size_t SPARSE_MAX_SIZE = 2048;
+
+		using Sparse = std::array<size_t, SPARSE_MAX_SIZE>;
+
+		// Everything the set allocates comes from here, see ECS::ECS(memory_resource*)
+		std::pmr::memory_resource* m_resource;
+
+		// Copy-on-write like PagedVector, copies of a set share pages until they write to them
+		std::pmr::vector<std::shared_ptr<Sparse>> m_sparsePages{ m_resource };
+
+		// Raw pointers to the same pages, saves lookups going through the shared_ptrs
+		std::pmr::vector<const Sparse*> m_sparseView{ m_resource };
+
+		std::pmr::vector<EntityID> m_denseToEntity{ m_resource }; // 1:1 vector where dense index == Entity Index
+
+		// Epoch each dense block was last written in, and the epoch new writes are stamped with
+		std::pmr::vector<uint64_t> m_blockEpochs{ m_resource };
+		uint64_t m_epoch = 1;
+
+		// Number of dense elements per dirty block
+		const size_t m_dirtyBlockSize;
+
+		// HashRange() of every dense block as of the epoch it was computed in, see Hash()
+		std::pmr::vector<uint64_t> m_blockHashes{ m_resource };
+		std::pmr::vector<uint64_t> m_blockHashEpochs{ m_resource };
+		size_t m_hashedSize = 0;
+
+		// Components Reserve() made room for, the set grows as needed until then
+		size_t m_capacity = std::numeric_limits<size_t>::max();
+
+		SparseSetBase(size_t dirtyBlockSize, std::pmr::memory_resource* resource) :
+			m_resource{ resource },
+			m_dirtyBlockSize{ dirtyBlockSize }
+		{
+			// Avoids initial copies/allocation, feel free to alter size
+			m_denseToEntity.reserve(1000);
+		}
+
+		inline void MarkBlockDirty(size_t block) {
+			if (block >= m_blockEpochs.size())
+				m_blockEpochs.resize(block + 1, 0);
+			m_blockEpochs[block] = m_epoch;
+		}
+
+		// Grows a vector ahead of count more elements, keeping growth geometric across calls
+		template <typename Vector>
+		static void ReserveMore(Vector& vector, size_t count) {
+			size_t needed = vector.size() + count;
+			if (needed > vector.capacity())
+				vector.reserve(std::max(needed, vector.capacity() * 2));
+		}
+
+		/*
+		*  Maps count new entities to the dense indices following the current end,
+		*  marking their blocks dirty. The derived pool appends the component data.
+		*/
+		void AppendEntities(const EntityID* ids, size_t count) {
+			if (count == 0) return;
+
+			size_t start = m_denseToEntity.size();
+			ReserveMore(m_denseToEntity, count);
+			m_denseToEntity.insert(m_denseToEntity.end(), ids, ids + count);
+
+			EnsureSparsePage(*std::max_element(ids, ids + count) / SPARSE_MAX_SIZE);
+			for (size_t i = 0; i < count; i++)
+				WritableSparsePage(ids[i] / SPARSE_MAX_SIZE)[ids[i] % SPARSE_MAX_SIZE] = start + i;
+
+			for (size_t block = start / m_dirtyBlockSize; block * m_dirtyBlockSize < start + count; block++)
+				MarkBlockDirty(block);
+		}
+
+		/*
+		* Inserts a given dense index into the sparse vector, associating
+		* an Entity ID with the index in the dense vector.
+		*
+		* This doesnt actually insert anything into the dense
+		* vector, it simply defines a mapping from ID -> index
+		*/
+		inline void SetDenseIndex(EntityID id, size_t index) {
+			size_t page = id / SPARSE_MAX_SIZE;
+			size_t sparseIndex = id % SPARSE_MAX_SIZE; // Index local to a page
+
+			EnsureSparsePage(page);
+
+			Sparse& sparse = WritableSparsePage(page);
+
+			sparse[sparseIndex] = index;
+		}
+
+		// Copies the entity mapping and epochs, the derived set copies the component data.
+		// Sparse pages end up shared between both sets, unless they use different memory resources.
+		void CopyBaseFrom(const SparseSetBase& other) {
+			SEECS_ASSERT(m_dirtyBlockSize == other.m_dirtyBlockSize, "Copying between different kinds of sets");
+			if (m_resource->is_equal(*other.m_resource)) {
+				m_sparsePages = other.m_sparsePages;
+				m_sparseView = other.m_sparseView;
+			}
+			else {
+				m_sparsePages.clear();
+				m_sparseView.clear();
+				for (const std::shared_ptr<Sparse>& page : other.m_sparsePages) {
+					m_sparsePages.push_back(page == EmptySparsePage() ? page : NewSparsePage(*page));
+					m_sparseView.push_back(m_sparsePages.back().get());
+				}
+			}
+			m_denseToEntity = other.m_denseToEntity;
+			m_blockEpochs = other.m_blockEpochs;
+			m_epoch = other.m_epoch;
+			m_capacity = other.m_capacity;
+
+			m_blockHashes = other.m_blockHashes;
+			m_blockHashEpochs = other.m_blockHashEpochs;
+			m_hashedSize = other.m_hashedSize;
+		}
+
+		// Page of tombstones shared by every set until they write to it
+		static const std::shared_ptr<Sparse>& EmptySparsePage() {
+			static const std::shared_ptr<Sparse> page = [] {
+				auto empty = std::make_shared<Sparse>();
+				empty->fill(tombstone);
+				return empty;
+			}();
+			return page;
+		}
+
+		std::shared_ptr<Sparse> NewSparsePage(const Sparse& contents) {
+			return std::allocate_shared<Sparse>(std::pmr::polymorphic_allocator<Sparse>{ m_resource }, contents);
+		}
+
+		inline void EnsureSparsePage(size_t page) {
+			// IDs can skip whole pages, every new page has to start out empty
+			if (page >= m_sparsePages.size()) {
+				m_sparsePages.resize(page + 1, EmptySparsePage());
+				m_sparseView.resize(page + 1, EmptySparsePage().get());
+			}
+		}
+
+		// Unshares a sparse page before it gets written to
+		inline Sparse& WritableSparsePage(size_t page) {
+			std::shared_ptr<Sparse>& shared = m_sparsePages[page];
+			if (shared.use_count() > 1) {
+				shared = NewSparsePage(*shared);
+				m_sparseView[page] = shared.get();
+			}
+			return *shared;
+		}
+
+		/*
+		*  Component data hooks used by Serialize()/Deserialize(). DeserializeRange() overwrites
+		*  existing indices and appends the rest, TruncateDense() pops back down to a size.
+		*/
+		virtual void SerializeRange(SnapshotWriter& writer, size_t start, size_t count) = 0;
+		virtual void DeserializeRange(SnapshotReader& reader, size_t start, size_t count) = 0;
+		virtual void TruncateDense(size_t size) = 0;
+
+		// Reserves the component data for count elements, see Reserve()
+		virtual void ReserveDense(size_t count) = 0;
+
+		// Swaps the component data at two dense indices, the entity mapping is handled by SwapEntries()
+		virtual void SwapDense(size_t a, size_t b) = 0;
+
+		void SwapEntries(size_t a, size_t b) {
+			if (a == b) return;
+
+			SwapDense(a, b);
+			std::swap(m_denseToEntity[a], m_denseToEntity[b]);
+			SetDenseIndex(m_denseToEntity[a], a);
+			SetDenseIndex(m_denseToEntity[b], b);
+
+			MarkBlockDirty(a / m_dirtyBlockSize);
+			MarkBlockDirty(b / m_dirtyBlockSize);
+		}
+
+		/*
+		*  Sorts the set so that less(a, b) holds for the dense indices a < b,
+		*  permuting in place by following the cycles of the sorted order.
+		*/
+		template <typename Less>
+		void SortIndices(Less less) {
+			std::vector<size_t> order(m_denseToEntity.size());
+			for (size_t i = 0; i < order.size(); i++)
+				order[i] = i;
+
+			std::sort(order.begin(), order.end(), less);
+
+			// order[i] is the index currently holding what belongs at i
+			for (size_t start = 0; start < order.size(); start++) {
+				size_t current = start;
+				while (order[current] != start) {
+					size_t next = order[current];
+					SwapEntries(current, next);
+					order[current] = current;
+					current = next;
+				}
+				order[current] = current;
+			}
+		}
+
+	public:
+
+		static constexpr size_t tombstone = std::numeric_limits<size_t>::max();
+
+		/*
+		* Returns the dense index for a given entity ID,
+		* or a tombstone (null) value if non-existent
+		*/
+		inline size_t GetDenseIndex(EntityID id) const {
+			size_t page = id / SPARSE_MAX_SIZE;
+			size_t sparseIndex = id % SPARSE_MAX_SIZE;
+
+			if (page < m_sparseView.size()) {
+				const Sparse& sparse = *m_sparseView[page];
+				return sparse[sparseIndex];
+			}
+
+			return tombstone;
+		}
+
+		// Entity stored at the given dense index
+		EntityID EntityAt(size_t index) const {
+			return m_denseToEntity[index];
+		}
+
+		// Every entity in the set, in dense order
+		Span<const EntityID> Entities() const {
+			return { m_denseToEntity.data(), m_denseToEntity.size() };
+		}
+
+		size_t Size() override {
+			return m_denseToEntity.size();
+		}
+
+		std::vector<EntityID> GetEntityList() override {
+			return { m_denseToEntity.begin(), m_denseToEntity.end() };
+		}
+
+		std::pmr::memory_resource* MemoryResource() const {
+			return m_resource;
+		}
+
+		/*
+		*  Preallocates everything count components of entities below the given ID take: the
+		*  entity list, dirty blocks, sparse pages (unshared from copies of the set) and the
+		*  component data. Adding up to count components doesn't allocate afterwards, unless
+		*  the set is copied from and shares its pages again.
+		*/
+		void Reserve(size_t count, size_t entities) override {
+			m_capacity = count;
+			m_denseToEntity.reserve(count);
+			m_blockEpochs.reserve(count / m_dirtyBlockSize + 1);
+
+			if (entities > 0)
+				EnsureSparsePage((entities - 1) / SPARSE_MAX_SIZE);
+			for (size_t page = 0; page < m_sparsePages.size(); page++)
+				WritableSparsePage(page);
+
+			ReserveDense(count);
+		}
+
+		// Components the set holds without allocating, SIZE_MAX until Reserve()
+		size_t Capacity() const override {
+			return m_capacity;
+		}
+
+		bool ContainsEntity(EntityID id) override {
+			return GetDenseIndex(id) != tombstone;
+		}
+
+		bool IsEmpty() const {
+			return m_denseToEntity.empty();
+		}
+
+		/*
+		*  Sorts the set by entity ID, cmp takes two EntityIDs.
+		*/
+		template <typename Compare>
+		void SortByEntity(Compare cmp) {
+			SortIndices([this, &cmp](size_t a, size_t b) {
+				return cmp(m_denseToEntity[a], m_denseToEntity[b]);
+			});
+		}
+
+		/*
+		*  Moves the entities this set shares with other to the front, in the order
+		*  other stores them. The rest keep no particular order after them.
+		*  Returns the number of shared entities, i.e. the length of the matching prefix.
+		*/
+		size_t SortAs(const SparseSetBase& other) {
+			size_t position = 0;
+			for (EntityID id : other.Entities()) {
+				size_t index = GetDenseIndex(id);
+				if (index == tombstone) continue;
+
+				SwapEntries(position, index);
+				position++;
+			}
+			return position;
+		}
+
+		/*
+		*  Starts a new epoch and returns it. Writes from here on are stamped with
+		*  the returned value, so passing it to Serialize() later on only writes
+		*  the blocks that changed in between.
+		*/
+		uint64_t AdvanceEpoch() override {
+			return ++m_epoch;
+		}
+
+		/*
+		*  Same as HashRange(0, Size()), order-independent, but only rehashes the dense blocks
+		*  written to since the last call, so hashing every tick costs in proportion to what
+		*  changed. Advances the epoch, like snapshots do.
+		*/
+		uint64_t Hash() {
+			for (size_t block : StaleHashBlocks())
+				RehashBlock(block);
+			return FinishHash();
+		}
+
+		/*
+		*  Hash() in steps, so blocks can be rehashed on several threads: StaleHashBlocks() lists
+		*  the blocks whose cached hash is out of date, RehashBlock() can then run concurrently
+		*  for different blocks, and FinishHash() adds everything up.
+		*/
+		std::vector<size_t> StaleHashBlocks() {
+			size_t size = m_denseToEntity.size();
+			size_t blockCount = (size + m_dirtyBlockSize - 1) / m_dirtyBlockSize;
+			m_blockHashes.resize(blockCount, 0);
+			m_blockHashEpochs.resize(blockCount, 0);
+
+			std::vector<size_t> stale;
+			for (size_t block = 0; block < blockCount; block++) {
+				// Deletes shrink the last block without marking it
+				bool shrunk = block + 1 == blockCount && size != m_hashedSize;
+				if (shrunk || block >= m_blockEpochs.size() || m_blockEpochs[block] > m_blockHashEpochs[block])
+					stale.push_back(block);
+			}
+			return stale;
+		}
+
+		void RehashBlock(size_t block) {
+			size_t start = block * m_dirtyBlockSize;
+			m_blockHashes[block] = HashRange(start, std::min(m_dirtyBlockSize, m_denseToEntity.size() - start));
+			m_blockHashEpochs[block] = m_epoch;
+		}
+
+		uint64_t FinishHash() {
+			uint64_t hash = 0;
+			for (uint64_t blockHash : m_blockHashes)
+				hash += blockHash;
+
+			// Anything written from here on is newer than the cached hashes
+			m_hashedSize = m_denseToEntity.size();
+			AdvanceEpoch();
+			return hash;
+		}
+
+		/*
+		*  Writes the dense blocks stamped with an epoch >= sinceEpoch, passing
+		*  0 writes every block. Layout:
+		*
+		*    size, blockCount, { blockIndex, entities[], components[] } * blockCount
+		*/
+		void Serialize(SnapshotWriter& writer, uint64_t sinceEpoch) override {
+			size_t size = m_denseToEntity.size();
+			size_t blockCount = (size + m_dirtyBlockSize - 1) / m_dirtyBlockSize;
+
+			std::vector<uint64_t> dirtyBlocks;
+			for (size_t block = 0; block < blockCount; block++)
+				if (sinceEpoch == 0 || m_blockEpochs[block] >= sinceEpoch)
+					dirtyBlocks.push_back(block);
+
+			writer.Write<uint64_t>(size);
+			writer.Write<uint64_t>(dirtyBlocks.size());
+
+			for (uint64_t block : dirtyBlocks) {
+				size_t start = block * m_dirtyBlockSize;
+				size_t count = std::min(m_dirtyBlockSize, size - start);
+
+				writer.Write<uint64_t>(block);
+				writer.WriteBytes(&m_denseToEntity[start], count * sizeof(EntityID));
+				SerializeRange(writer, start, count);
+			}
+		}
+
+		/*
+		*  Applies blocks written by Serialize(). The set must be in the state
+		*  Serialize() diffed against, which for a full snapshot is any state.
+		*/
+		void Deserialize(SnapshotReader& reader) override {
+			size_t oldSize = m_denseToEntity.size();
+			size_t newSize = reader.Read<uint64_t>();
+			size_t blockCount = reader.Read<uint64_t>();
+
+			// Only unmap an entity if it still points to the slot being overwritten,
+			// it may have already been remapped by a block applied earlier.
+			auto unmap = [this](size_t index) {
+				EntityID old = m_denseToEntity[index];
+				if (GetDenseIndex(old) == index)
+					SetDenseIndex(old, tombstone);
+			};
+
+			for (size_t index = newSize; index < oldSize; index++)
+				unmap(index);
+
+			std::vector<EntityID> entities;
+			for (size_t i = 0; i < blockCount; i++) {
+				size_t block = reader.Read<uint64_t>();
+				size_t start = block * m_dirtyBlockSize;
+				size_t count = std::min(m_dirtyBlockSize, newSize - start);
+
+				SEECS_ASSERT(start <= m_denseToEntity.size(), "Snapshot blocks out of order");
+
+				entities.resize(count);
+				reader.ReadBytes(entities.data(), count * sizeof(EntityID));
+
+				for (size_t j = 0; j < count; j++) {
+					size_t index = start + j;
+					if (index < m_denseToEntity.size()) {
+						unmap(index);
+						m_denseToEntity[index] = entities[j];
+					}
+					else {
+						m_denseToEntity.push_back(entities[j]);
+					}
+					SetDenseIndex(entities[j], index);
+				}
+
+				DeserializeRange(reader, start, count);
+				MarkBlockDirty(block);
+			}
+
+			if (m_denseToEntity.size() > newSize) {
+				m_denseToEntity.resize(newSize);
+				TruncateDense(newSize);
+			}
+		}
+
+	};
+
+
+
+	/*
+	*  Secondary index over the components of a pool, see HashIndex and OrderedIndex.
+	*  The pool calls Insert()/Erase() whenever a component is added, overwritten,
+	*  patched or removed.
+	*/
+	template <typename T>
+	class IComponentIndex {
+	public:
+		virtual ~IComponentIndex() = default;
+		virtual void Insert(EntityID id, const T& component) = 0;
+		virtual void Erase(EntityID id, const T& component) = 0;
+		virtual void Clear() = 0;
+		virtual std::unique_ptr<IComponentIndex> Clone() const = 0;
+	};
+
+
+
+	/*
+	*  A templated sparse set implementation, mapping EntityID -> T
+	* 
+	*  - Get(EntityID): returns T or NULL if EntityID is not in sparse set
+	*  - Set(EntityID, T&&): Adds/Overwrites into the dense list for the specified entity
+	*  - Delete(EntityID): Removes data for EntityID from dense list
+	*/
+	template <typename T>
+	class SparseSet: public SparseSetBase {
+	public:
+
+		using Dense = std::conditional_t<is_tag_v<T>, TagStorage<T>,
+			std::conditional_t<paged_storage<T>::value, PagedVector<T>, std::pmr::vector<T>>>;
+
+	private:
+
+		static constexpr size_t DIRTY_BLOCK_SIZE = std::max<size_t>(1, DIRTY_BLOCK_BYTES / sizeof(T));
+
+		Dense m_dense;
+
+		static Dense MakeDense(std::pmr::memory_resource* resource) {
+			if constexpr (is_tag_v<T>)
+				return {};
+			else
+				return Dense(resource);
+		}
+
+		inline void MarkDirty(size_t index) {
+			MarkBlockDirty(index / DIRTY_BLOCK_SIZE);
+		}
+
+		// Order kept by KeepSorted(), and the entities written since the last Resort()
+		std::function<bool(const T&, const T&)> m_sortOrder;
+		std::pmr::vector<EntityID> m_unsorted{ m_resource };
+		bool m_keepSorted = false;
+		bool m_needsFullSort = false;
+
+		// Secondary indexes, keyed by the type of the index (e.g HashIndex<&T::field>)
+		std::vector<std::pair<std::type_index, std::unique_ptr<IComponentIndex<T>>>> m_indexes;
+
+		inline void IndexInsert(EntityID id, const T& component) {
+			for (auto& [type, index] : m_indexes)
+				index->Insert(id, component);
+		}
+
+		inline void IndexErase(EntityID id, const T& component) {
+			for (auto& [type, index] : m_indexes)
+				index->Erase(id, component);
+		}
+
+		void RebuildIndexes() {
+			for (auto& [type, index] : m_indexes) {
+				index->Clear();
+				for (size_t i = 0; i < m_dense.size(); i++)
+					index->Insert(m_denseToEntity[i], m_dense[i]);
+			}
+		}
+
+		// Past this many writes an incremental repair stops paying off
+		size_t UnsortedLimit() const {
+			return std::max<size_t>(64, m_dense.size() / 16);
+		}
+
+		// Sorting by anything else moves every component, only a full sort puts them back
+		void DropKeptOrder() {
+			if (!m_keepSorted) return;
+			m_needsFullSort = true;
+			m_unsorted.clear();
+		}
+
+		inline void TrackUnsorted(EntityID id) {
+			if (!m_keepSorted || m_needsFullSort) return;
+
+			if (m_unsorted.size() >= UnsortedLimit()) {
+				m_needsFullSort = true;
+				m_unsorted.clear();
+				return;
+			}
+			m_unsorted.push_back(id);
+		}
+
+		void FullSort() {
+			SortIndices([this](size_t a, size_t b) {
+				return m_sortOrder(std::as_const(m_dense[a]), std::as_const(m_dense[b]));
+			});
+		}
+
+		/*
+		*  Moves written components with adjacent swaps until none of them is out of order with
+		*  either neighbour. The rest are still ordered among themselves, so that means sorted.
+		*  Gives up after maxSwaps, returning false.
+		*/
+		bool SiftUnsorted(size_t maxSwaps) {
+			size_t size = m_dense.size();
+			size_t swaps = 0;
+
+			auto less = [this](size_t a, size_t b) {
+				return m_sortOrder(std::as_const(m_dense[a]), std::as_const(m_dense[b]));
+			};
+
+			bool moved = true;
+			while (moved) {
+				moved = false;
+
+				for (EntityID id : m_unsorted) {
+					size_t index = GetDenseIndex(id);
+					if (index == tombstone) continue;
+
+					while (index > 0 && less(index, index - 1)) {
+						if (++swaps > maxSwaps) return false;
+						SwapEntries(index, index - 1);
+						index--;
+						moved = true;
+					}
+					while (index + 1 < size && less(index + 1, index)) {
+						if (++swaps > maxSwaps) return false;
+						SwapEntries(index, index + 1);
+						index++;
+						moved = true;
+					}
+				}
+			}
+
+			return true;
+		}
+
+		/*
+		*  Takes the written components out, sorts them and merges them back into the rest,
+		*  which are still in order among themselves.
+		*/
+		void MergeUnsorted() {
+			std::vector<size_t> indices;
+			for (EntityID id : m_unsorted) {
+				size_t index = GetDenseIndex(id);
+				if (index != tombstone)
+					indices.push_back(index);
+			}
+			if (indices.empty()) return;
+
+			std::sort(indices.begin(), indices.end());
+
+			size_t size = m_dense.size();
+			size_t first = indices.front();
+
+			// Pull the written components out, closing the gaps
+			std::vector<T> written;
+			std::vector<EntityID> writtenEntities;
+			written.reserve(indices.size());
+			writtenEntities.reserve(indices.size());
+
+			size_t write = first;
+			size_t next = 0;
+			for (size_t read = first; read < size; read++) {
+				if (next < indices.size() && indices[next] == read) {
+					written.push_back(std::move(m_dense[read]));
+					writtenEntities.push_back(m_denseToEntity[read]);
+					next++;
+				}
+				else {
+					if (write != read) {
+						m_dense[write] = std::move(m_dense[read]);
+						m_denseToEntity[write] = m_denseToEntity[read];
+					}
+					write++;
+				}
+			}
+
+			std::vector<size_t> order(written.size());
+			for (size_t i = 0; i < order.size(); i++)
+				order[i] = i;
+			std::sort(order.begin(), order.end(), [this, &written](size_t a, size_t b) {
+				return m_sortOrder(std::as_const(written[a]), std::as_const(written[b]));
+			});
+
+			// Merge from the back, binary searching each written component's spot among the kept
+			// ones so comparisons stay at k log n. Ties keep the written component last.
+			size_t kept = write;
+			size_t out = size;
+			for (size_t remaining = order.size(); remaining > 0; remaining--) {
+				size_t source = order[remaining - 1];
+				const T& candidate = written[source];
+
+				size_t low = 0;
+				size_t high = kept;
+				while (low < high) {
+					size_t mid = low + (high - low) / 2;
+					if (m_sortOrder(candidate, std::as_const(m_dense[mid])))
+						high = mid;
+					else
+						low = mid + 1;
+				}
+
+				while (kept > low) {
+					out--;
+					kept--;
+					m_dense[out] = std::move(m_dense[kept]);
+					m_denseToEntity[out] = m_denseToEntity[kept];
+				}
+
+				out--;
+				m_dense[out] = std::move(written[source]);
+				m_denseToEntity[out] = writtenEntities[source];
+			}
+
+			size_t start = std::min(first, out);
+			for (size_t index = start; index < size; index++) {
+				SetDenseIndex(m_denseToEntity[index], index);
+				if (index == start || index % DIRTY_BLOCK_SIZE == 0)
+					MarkDirty(index);
+			}
+		}
+
+	protected:
+
+		void SerializeRange(SnapshotWriter& writer, size_t start, size_t count) override {
+			if constexpr (is_tag_v<T>) {
+				// Membership is all there is, and the entity list is written by the base
+			}
+			else if constexpr (std::is_trivially_copyable_v<T>) {
+				for (size_t index = start; index < start + count;) {
+					size_t run = std::min(start + count - index, ContiguousRun(index));
+					writer.WriteBytes(&std::as_const(m_dense)[index], run * sizeof(T));
+					index += run;
+				}
+			}
+			else {
+				SEECS_ASSERT(false, "Component '" << typeid(T).name() << "' is not trivially copyable and can't be snapshotted");
+			}
+		}
+
+		void DeserializeRange(SnapshotReader& reader, size_t start, size_t count) override {
+			if constexpr (is_tag_v<T>) {
+				while (m_dense.size() < start + count)
+					m_dense.push_back({});
+			}
+			else if constexpr (std::is_trivially_copyable_v<T>) {
+				for (size_t index = start; index < start + count; index++) {
+					alignas(T) unsigned char storage[sizeof(T)];
+					reader.ReadBytes(storage, sizeof(T));
+					const T& value = *reinterpret_cast<const T*>(storage);
+
+					if (index < m_dense.size())
+						m_dense[index] = value;
+					else
+						m_dense.push_back(value);
+				}
+
+				if (m_keepSorted)
+					m_needsFullSort = true;
+			}
+			else {
+				SEECS_ASSERT(false, "Component '" << typeid(T).name() << "' is not trivially copyable and can't be snapshotted");
+			}
+		}
+
+		void TruncateDense(size_t size) override {
+			while (m_dense.size() > size)
+				m_dense.pop_back();
+		}
+
+		void ReserveDense(size_t count) override {
+			m_dense.reserve(count);
+			if constexpr (std::is_same_v<Dense, PagedVector<T>>)
+				m_dense.Unshare();
+			m_unsorted.reserve(std::max<size_t>(64, count / 16));
+		}
+
+		void SwapDense(size_t a, size_t b) override {
+			std::swap(m_dense[a], m_dense[b]);
+		}
+
+	public:
+
+		explicit SparseSet(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+			SparseSetBase{ DIRTY_BLOCK_SIZE, resource },
+			m_dense{ MakeDense(resource) }
+		{
+			// Avoids initial copies/allocation, feel free to alter size
+			m_dense.reserve(1000);
+		}
+
+		SparseSet(const SparseSet& other) :
+			SparseSetBase{ DIRTY_BLOCK_SIZE, other.m_resource },
+			m_dense{ MakeDense(other.m_resource) }
+		{
+			CopyFrom(other);
+		}
+
+		// Takes the storage along with its resource, see MoveToResource()
+		SparseSet(SparseSet&& other) = default;
+
+		SparseSet& operator=(const SparseSet& other) {
+			CopyFrom(other);
+			return *this;
+		}
+
+		std::unique_ptr<ISparseSet> Clone(std::pmr::memory_resource* resource) const override {
+			auto copy = std::make_unique<SparseSet>(resource);
+			copy->CopyFrom(*this);
+			return copy;
+		}
+
+		/*
+		*  Moves the set's storage to another memory resource, the set object itself stays
+		*  where it is so pointers to it (views, accessors) remain valid. References and
+		*  spans into the old storage don't. See ECS::SetPoolMemoryResource().
+		*/
+		void MoveToResource(std::pmr::memory_resource* resource) {
+			SparseSet moved{ resource };
+			moved.CopyFrom(*this);
+
+			// Allocators of pmr containers are fixed, so the set is rebuilt on the new resource.
+			// Everything that can throw is done by now, moving the copy in can't.
+			static_assert(std::is_nothrow_move_constructible_v<SparseSet>);
+			this->~SparseSet();
+			new (this) SparseSet(std::move(moved));
+		}
+
+		/*
+		*  Becomes a copy of other, including its sort order and indexes. Sparse pages and
+		*  PagedVector pages are shared until either set writes to them (as long as both sets use
+		*  the same memory resource), the rest is assigned into the existing vectors, with memcpy
+		*  for trivially copyable components.
+		*/
+		void CopyFrom(const ISparseSet& other) override {
+			if (&other == this) return;
+			const SparseSet& source = static_cast<const SparseSet&>(other);
+
+			CopyBaseFrom(source);
+			m_dense = source.m_dense;
+
+			m_sortOrder = source.m_sortOrder;
+			m_unsorted = source.m_unsorted;
+			m_keepSorted = source.m_keepSorted;
+			m_needsFullSort = source.m_needsFullSort;
+
+			m_indexes.clear();
+			for (const auto& [type, index] : source.m_indexes)
+				m_indexes.push_back({ type, index->Clone() });
+		}
+
+		T* Set(EntityID id, T obj) {
+			// Overwrite existing elements
+			size_t index = GetDenseIndex(id);
+			if (index != tombstone) {
+				if (!m_indexes.empty()) {
+					IndexErase(id, m_dense[index]);
+					IndexInsert(id, obj);
+				}
+
+				m_dense[index] = obj;
+				m_denseToEntity[index] = id;
+				MarkDirty(index);
+				TrackUnsorted(id);
+
+				return &m_dense[index];
+			}
+
+			// New index will be the back of the dense list
+			SetDenseIndex(id, m_dense.size());
+			MarkDirty(m_dense.size());
+			TrackUnsorted(id);
+
+			if (!m_indexes.empty())
+				IndexInsert(id, obj);
+
+			m_dense.push_back(obj);
+			m_denseToEntity.push_back(id);
+
+			return &m_dense.back();
+		}
+
+		T* Get(EntityID id) {
+			size_t index = GetDenseIndex(id);
+			if (index == tombstone)
+				return nullptr;
+
+			MarkDirty(index);
+			TrackUnsorted(id);
+			return &m_dense[index];
+		}
+
+		// Read-only access, doesn't mark anything dirty
+		const T* Get(EntityID id) const {
+			size_t index = GetDenseIndex(id);
+			return (index != tombstone) ? &m_dense[index] : nullptr;
+		}
+
+		T& GetRef(EntityID id) {
+			size_t index = GetDenseIndex(id);
+			if (index == tombstone)
+				SEECS_ASSERT(false, "GetRef called on invalid entity with ID " << id);
+			MarkDirty(index);
+			TrackUnsorted(id);
+			return m_dense[index];
+		}
+
+		// Read-only access, doesn't mark anything dirty
+		const T& GetRef(EntityID id) const {
+			size_t index = GetDenseIndex(id);
+			if (index == tombstone)
+				SEECS_ASSERT(false, "GetRef called on invalid entity with ID " << id);
+			return m_dense[index];
+		}
+
+		void Delete(EntityID id) override {
+
+			size_t deletedIndex = GetDenseIndex(id);
+
+			if (m_dense.empty() || deletedIndex == tombstone) return;
+
+			if (!m_indexes.empty())
+				IndexErase(id, m_dense[deletedIndex]);
+
+			// The last component fills the hole, which is almost never its sorted spot
+			TrackUnsorted(m_denseToEntity.back());
+
+			SetDenseIndex(m_denseToEntity.back(), deletedIndex);
+			SetDenseIndex(id, tombstone);
+
+			std::swap(m_dense.back(), m_dense[deletedIndex]);
+			std::swap(m_denseToEntity.back(), m_denseToEntity[deletedIndex]);
+			MarkDirty(deletedIndex);
+
+			m_dense.pop_back();
+			m_denseToEntity.pop_back();
+		}
+
+		void Clear() override {
+			m_dense.clear();
+			m_sparsePages.clear();
+			m_sparseView.clear();
+			m_denseToEntity.clear();
+			m_blockEpochs.clear();
+			m_unsorted.clear();
+			m_needsFullSort = false;
+
+			for (auto& [type, index] : m_indexes)
+				index->Clear();
+		}
+
+		/*
+		*  Modifies a component through func(T&), keeping any indexes up to date.
+		*  Indexed fields must only be changed through Patch() or Set().
+		*/
+		template <typename Func>
+		void Patch(EntityID id, Func func) {
+			T& component = GetRef(id);
+
+			IndexErase(id, component);
+			func(component);
+			IndexInsert(id, component);
+		}
+
+		/*
+		*  Appends the same component for count entities that aren't in the set yet,
+		*  growing the dense list once instead of per entity.
+		*/
+		void Fill(const EntityID* ids, size_t count, const T& value) {
+			AppendEntities(ids, count);
+
+			if constexpr (std::is_same_v<Dense, std::pmr::vector<T>>) {
+				ReserveMore(m_dense, count);
+				m_dense.insert(m_dense.end(), count, value);
+			}
+			else {
+				m_dense.reserve(m_dense.size() + count);
+				for (size_t i = 0; i < count; i++)
+					m_dense.push_back(value);
+			}
+
+			if (m_keepSorted)
+				for (size_t i = 0; i < count; i++)
+					TrackUnsorted(ids[i]);
+
+			if (!m_indexes.empty())
+				for (size_t i = 0; i < count; i++)
+					IndexInsert(ids[i], value);
+		}
+
+		void CloneComponent(EntityID source, const EntityID* targets, size_t count) override {
+			// Copied first, growing the dense list may move the source
+			T value = std::as_const(*this).GetRef(source);
+			Fill(targets, count, value);
+		}
+
+		size_t TracedSize() const override {
+			return traced_size_v<T>;
+		}
+
+		void SetTraced(EntityID id, const void* bytes) override {
+			if constexpr (traced_size_v<T> > 0) {
+				if (bytes) {
+					alignas(T) unsigned char storage[sizeof(T)];
+					std::memcpy(storage, bytes, sizeof(T));
+					Set(id, *reinterpret_cast<const T*>(storage));
+					return;
+				}
+			}
+
+			if constexpr (std::is_default_constructible_v<T>)
+				Set(id, T{});
+			else
+				SEECS_ASSERT(false, "Component '" << typeid(T).name() << "' can't be replayed, it isn't default constructible");
+		}
+
+		uint64_t HashRange(size_t start, size_t count) const override {
+			uint64_t hash = 0;
+			for (size_t i = start; i < start + count; i++)
+				hash += HashComponent(m_denseToEntity[i], m_dense[i]);
+			return hash;
+		}
+
+		/*
+		*  Takes ownership of an index under the given key, filling it with the current components
+		*/
+		void AddIndex(std::type_index type, std::unique_ptr<IComponentIndex<T>> index) {
+			SEECS_ASSERT(!GetIndex(type), "Index '" << type.name() << "' already exists");
+
+			for (size_t i = 0; i < m_dense.size(); i++)
+				index->Insert(m_denseToEntity[i], std::as_const(m_dense)[i]);
+			m_indexes.push_back({ type, std::move(index) });
+		}
+
+		IComponentIndex<T>* GetIndex(std::type_index type) const {
+			for (const auto& [key, index] : m_indexes)
+				if (key == type)
+					return index.get();
+			return nullptr;
+		}
+
+		void Deserialize(SnapshotReader& reader) override {
+			SparseSetBase::Deserialize(reader);
+			if (!m_indexes.empty())
+				RebuildIndexes();
+		}
+
+		/*
+		*  Sorts the dense list in place, lost again as soon as something is deleted.
+		*  cmp either compares two components (const T&, const T&), or two EntityIDs.
+		*
+		*    pool.Sort([](const Sprite& a, const Sprite& b) { return a.depth < b.depth; });
+		*/
+		template <typename Compare>
+		void Sort(Compare cmp) {
+			if constexpr (std::is_invocable_r_v<bool, Compare&, const T&, const T&>) {
+				DropKeptOrder();
+				SortIndices([this, &cmp](size_t a, size_t b) {
+					return cmp(std::as_const(m_dense[a]), std::as_const(m_dense[b]));
+				});
+			}
+			else {
+				SortByEntity(cmp);
+			}
+		}
+
+		// See SparseSetBase::SortByEntity(), the KeepSorted() order is restored by the next Resort()
+		template <typename Compare>
+		void SortByEntity(Compare cmp) {
+			DropKeptOrder();
+			SparseSetBase::SortByEntity(cmp);
+		}
+
+		// See SparseSetBase::SortAs(), the KeepSorted() order is restored by the next Resort()
+		size_t SortAs(const SparseSetBase& other) {
+			DropKeptOrder();
+			return SparseSetBase::SortAs(other);
+		}
+
+		/*
+		*  Sorts the pool by cmp(const T&, const T&) and keeps track of every component written
+		*  from then on (Set, mutable Get/GetRef, views, deletes moving components around).
+		*  Resort() then only moves those back into place instead of sorting everything again:
+		*
+		*    pool.KeepSorted([](const Sprite& a, const Sprite& b) { return a.depth < b.depth; });
+		*    ...
+		*    pool.Resort(); // Every frame, before iterating in order
+		*/
+		template <typename Compare>
+		void KeepSorted(Compare cmp) {
+			m_sortOrder = cmp;
+			m_keepSorted = true;
+			m_needsFullSort = true;
+			m_unsorted.clear();
+			Resort();
+		}
+
+		void StopSorting() {
+			m_sortOrder = nullptr;
+			m_keepSorted = false;
+			m_needsFullSort = false;
+			m_unsorted.clear();
+		}
+
+		/*
+		*  Restores the KeepSorted() order, in proportion to what was written since the last call:
+		*
+		*  - Written components are first sifted towards their spot with insertion sort steps,
+		*    which is all it takes when they only moved a little.
+		*  - Past a few swaps per write, the written components are pulled out, sorted on their own
+		*    and merged back in, moving only the dense range from the first one onwards.
+		*  - Past UnsortedLimit() writes, the pool is sorted from scratch.
+		*/
+		void Resort() {
+			if (!m_keepSorted) return;
+
+			if (!m_needsFullSort && !m_unsorted.empty()) {
+				std::sort(m_unsorted.begin(), m_unsorted.end());
+				m_unsorted.erase(std::unique(m_unsorted.begin(), m_unsorted.end()), m_unsorted.end());
+
+				if (!SiftUnsorted(8 * m_unsorted.size()))
+					MergeUnsorted();
+			}
+			else if (m_needsFullSort) {
+				FullSort();
+			}
+
+			m_unsorted.clear();
+			m_needsFullSort = false;
+		}
+
+		bool IsKeptSorted() const {
+			return m_keepSorted;
+		}
+
+		// Number of components stored contiguously from the given dense index
+		size_t ContiguousRun(size_t index) const {
+			return seecs::ContiguousRun(m_dense, index);
+		}
+
+		/*
+		*  Mutable span over count components starting at a dense index,
+		*  count must not exceed ContiguousRun(index).
+		*/
+		Span<T> DenseRun(size_t index, size_t count) {
+			static_assert(!is_tag_v<T>, "Tag components have no data to span over");
+			for (size_t block = index / DIRTY_BLOCK_SIZE; block * DIRTY_BLOCK_SIZE < index + count; block++)
+				MarkBlockDirty(block);
+			for (size_t i = index; i < index + count && m_keepSorted && !m_needsFullSort; i++)
+				TrackUnsorted(m_denseToEntity[i]);
+			return { &m_dense[index], count };
+		}
+
+		Span<const T> DenseRun(size_t index, size_t count) const {
+			static_assert(!is_tag_v<T>, "Tag components have no data to span over");
+			return { &m_dense[index], count };
+		}
+
+		// Read-only dense list, either a std::pmr::vector, PagedVector or TagStorage
+		const Dense& Data() const {
+			return m_dense;
+		}
+
+		void PrintDense() {
+			std::stringstream ss;
+			std::string delim = "";
+			for (const T& e : m_dense) {
+				ss << delim << e;
+				if (delim.empty())
+					delim = ", ";
+			}
+			SEECS_INFO("[" << ss.str() << "]");
+		}
+
+	};
+
+
+
+	/*
+	*  Minimal allocator returning memory aligned to Alignment bytes from a memory resource.
+	*  Moving a vector moves its resource along, copying one keeps the resource of the target.
+	*/
+	template <typename T, size_t Alignment>
+	struct AlignedAllocator {
+		using value_type = T;
+		using propagate_on_container_move_assignment = std::true_type;
+
+		template <typename U>
+		struct rebind {
+			using other = AlignedAllocator<U, Alignment>;
+		};
+
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+
+		AlignedAllocator() = default;
+
+		AlignedAllocator(std::pmr::memory_resource* resource) :
+			resource{ resource }
+		{}
+
+		template <typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment>& other) :
+			resource{ other.resource }
+		{}
+
+		T* allocate(size_t count) {
+			return static_cast<T*>(resource->allocate(count * sizeof(T), Alignment));
+		}
+
+		void deallocate(T* ptr, size_t count) {
+			resource->deallocate(ptr, count * sizeof(T), Alignment);
+		}
+
+		template <typename U>
+		bool operator==(const AlignedAllocator<U, Alignment>& other) const { return resource->is_equal(*other.resource); }
+
+		template <typename U>
+		bool operator!=(const AlignedAllocator<U, Alignment>& other) const { return !(*this == other); }
+	};
+
+
+
+	template <typename Member>
+	struct member_traits;
+
+	template <typename Class, typename Field>
+	struct member_traits<Field Class::*> {
+		using class_type = Class;
+		using field_type = Field;
+	};
+
+	/*
+	*  Compile-time list of data member pointers, see soa_fields
+	*/
+	template <auto... Members>
+	struct field_list {
+		static constexpr size_t size = sizeof...(Members);
+
+		template <size_t Index>
+		static constexpr auto member = std::get<Index>(std::make_tuple(Members...));
+
+		template <size_t Index>
+		using field_type = typename member_traits<std::remove_const_t<decltype(member<Index>)>>::field_type;
+	};
+
+	/*
+	*  Opt-in trait storing an aggregate component as a structure of arrays, with
+	*  every listed field in its own SIMD aligned column:
+	*
+	*    template <> struct seecs::soa_fields<Position> : seecs::field_list<&Position::x, &Position::y, &Position::z> {};
+	*
+	*  Fields that aren't listed are not stored.
+	*/
+	template <typename T>
+	struct soa_fields : field_list<> {};
+
+	template <typename T>
+	constexpr bool is_soa_v = soa_fields<std::remove_const_t<T>>::size > 0;
+
+
+
+	/*
+	*  Spans over the same run of entities in every column of an SoA component, which is what
+	*  SimpleView::ForEachChunk() hands out for them:
+	*
+	*    view.ForEachChunk([](Span<Velocity> v, ColumnSpans<Position> p) {
+	*        Span<float> x = p.Field<&Position::x>();
+	*        for (size_t i = 0; i < p.size; i++)
+	*            x[i] += v[i].x;
+	*    });
+	*
+	*  ColumnSpans<const T> spans const fields.
+	*/
+	template <typename T>
+	class SoASparseSet;
+
+	template <typename T>
+	struct ColumnSpans {
+	private:
+
+		using Fields = soa_fields<std::remove_const_t<T>>;
+
+		template <size_t Index>
+		using FieldSpan = Span<std::conditional_t<std::is_const_v<T>,
+			const typename Fields::template field_type<Index>, typename Fields::template field_type<Index>>>;
+
+		template <size_t... Indices>
+		static auto MakeSpans(std::index_sequence<Indices...>) -> std::tuple<FieldSpan<Indices>...>;
+
+	public:
+
+		decltype(MakeSpans(std::make_index_sequence<Fields::size>{})) columns;
+		size_t size = 0;
+
+		template <auto Member>
+		auto Field() const {
+			return std::get<SoASparseSet<std::remove_const_t<T>>::template ColumnIndex<Member>()>(columns);
+		}
+	};
+
+
+
+	/*
+	*  Sparse set storing each field listed in soa_fields<T> in its own column,
+	*  so loops over a single field are contiguous and vectorize cleanly.
+	*
+	*  Since there's no T in memory there are no T& either, use:
+	*  - Column<&T::field>(): span over a whole column, in the same order as Entities()
+	*  - ColumnRun(index, count): spans over part of every column, see ColumnSpans
+	*  - GetField<&T::field>(EntityID): single field of a single entity
+	*  - Load(EntityID): assembles a copy of T
+	*/
+	template <typename T>
+	class SoASparseSet : public SparseSetBase {
+	public:
+
+		static constexpr size_t COLUMN_ALIGNMENT = 32; // AVX2 register width
+
+	private:
+
+		using Fields = soa_fields<T>;
+
+		static constexpr size_t DIRTY_BLOCK_SIZE = std::max<size_t>(1, DIRTY_BLOCK_BYTES / sizeof(T));
+
+		template <typename Field>
+		using ColumnVector = std::vector<Field, AlignedAllocator<Field, COLUMN_ALIGNMENT>>;
+
+		template <size_t... Indices>
+		static auto MakeColumns(std::index_sequence<Indices...>)
+			-> std::tuple<ColumnVector<typename Fields::template field_type<Indices>>...>;
+
+		using FieldIndices = std::make_index_sequence<Fields::size>;
+
+		decltype(MakeColumns(FieldIndices{})) m_columns;
+
+		template <auto A, auto B>
+		static constexpr bool SameMember() {
+			if constexpr (std::is_same_v<decltype(A), decltype(B)>)
+				return A == B;
+			else
+				return false;
+		}
+
+		template <auto Member, size_t... Indices>
+		static constexpr size_t IndexOf(std::index_sequence<Indices...>) {
+			size_t result = Fields::size;
+			((SameMember<Member, Fields::template member<Indices>>() ? (result = Indices) : 0), ...);
+			return result;
+		}
+
+		// Runs func(column, member) for every column
+		template <typename Columns, typename Func, size_t... Indices>
+		static void ForEachColumn(Columns& columns, Func func, std::index_sequence<Indices...>) {
+			(func(std::get<Indices>(columns), Fields::template member<Indices>), ...);
+		}
+
+		template <typename Func>
+		void ForEachColumn(Func func) {
+			ForEachColumn(m_columns, func, FieldIndices{});
+		}
+
+		template <typename Func>
+		void ForEachColumn(Func func) const {
+			ForEachColumn(m_columns, func, FieldIndices{});
+		}
+
+		inline void MarkDirty(size_t index) {
+			MarkBlockDirty(index / DIRTY_BLOCK_SIZE);
+		}
+
+		template <typename Spans, typename Columns, size_t... Indices>
+		static Spans MakeColumnSpans(Columns& columns, size_t index, size_t count, std::index_sequence<Indices...>) {
+			return { { { std::get<Indices>(columns).data() + index, count }... }, count };
+		}
+
+	protected:
+
+		void SerializeRange(SnapshotWriter& writer, size_t start, size_t count) override {
+			ForEachColumn([&](auto& column, auto) {
+				using Field = typename std::decay_t<decltype(column)>::value_type;
+				static_assert(std::is_trivially_copyable_v<Field>, "SoA fields must be trivially copyable to be snapshotted");
+				writer.WriteBytes(&column[start], count * sizeof(Field));
+			});
+		}
+
+		void DeserializeRange(SnapshotReader& reader, size_t start, size_t count) override {
+			ForEachColumn([&](auto& column, auto) {
+				using Field = typename std::decay_t<decltype(column)>::value_type;
+				if (column.size() < start + count)
+					column.resize(start + count);
+				reader.ReadBytes(&column[start], count * sizeof(Field));
+			});
+		}
+
+		void TruncateDense(size_t size) override {
+			ForEachColumn([size](auto& column, auto) { column.resize(size); });
+		}
+
+		void ReserveDense(size_t count) override {
+			ForEachColumn([count](auto& column, auto) { column.reserve(count); });
+		}
+
+		void SwapDense(size_t a, size_t b) override {
+			ForEachColumn([a, b](auto& column, auto) { std::swap(column[a], column[b]); });
+		}
+
+	public:
+
+		explicit SoASparseSet(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+			SparseSetBase{ DIRTY_BLOCK_SIZE, resource }
+		{
+			ForEachColumn([resource](auto& column, auto) {
+				column = std::decay_t<decltype(column)>(resource);
+				column.reserve(1000);
+			});
+		}
+
+		std::unique_ptr<ISparseSet> Clone(std::pmr::memory_resource* resource) const override {
+			auto copy = std::make_unique<SoASparseSet>(resource);
+			copy->CopyFrom(*this);
+			return copy;
+		}
+
+		// See SparseSet::MoveToResource()
+		void MoveToResource(std::pmr::memory_resource* resource) {
+			SoASparseSet moved{ resource };
+			moved.CopyFrom(*this);
+
+			static_assert(std::is_nothrow_move_constructible_v<SoASparseSet>);
+			this->~SoASparseSet();
+			new (this) SoASparseSet(std::move(moved));
+		}
+
+		void CopyFrom(const ISparseSet& other) override {
+			if (&other == this) return;
+			const SoASparseSet& source = static_cast<const SoASparseSet&>(other);
+
+			CopyBaseFrom(source);
+			m_columns = source.m_columns;
+		}
+
+		void Set(EntityID id, const T& obj) {
+			size_t index = GetDenseIndex(id);
+
+			if (index == tombstone) {
+				index = m_denseToEntity.size();
+				SetDenseIndex(id, index);
+				m_denseToEntity.push_back(id);
+				ForEachColumn([&](auto& column, auto member) { column.push_back(obj.*member); });
+			}
+			else {
+				ForEachColumn([&](auto& column, auto member) { column[index] = obj.*member; });
+			}
+
+			MarkDirty(index);
+		}
+
+		void Fill(const EntityID* ids, size_t count, const T& obj) {
+			AppendEntities(ids, count);
+			ForEachColumn([&](auto& column, auto member) {
+				ReserveMore(column, count);
+				column.insert(column.end(), count, obj.*member);
+			});
+		}
+
+		void CloneComponent(EntityID source, const EntityID* targets, size_t count) override {
+			Fill(targets, count, Load(source));
+		}
+
+		size_t TracedSize() const override {
+			return traced_size_v<T>;
+		}
+
+		void SetTraced(EntityID id, const void* bytes) override {
+			T value{};
+			if constexpr (traced_size_v<T> > 0)
+				if (bytes)
+					std::memcpy(&value, bytes, sizeof(T));
+			Set(id, value);
+		}
+
+		uint64_t HashRange(size_t start, size_t count) const override {
+			uint64_t hash = 0;
+			for (size_t i = start; i < start + count; i++) {
+				uint64_t element = m_denseToEntity[i];
+				ForEachColumn([&](const auto& column, auto) {
+					using Field = typename std::decay_t<decltype(column)>::value_type;
+					element = HashFixed<sizeof(Field)>(&column[i], element);
+				});
+				hash += element;
+			}
+			return hash;
+		}
+
+		T Load(EntityID id) const {
+			size_t index = GetDenseIndex(id);
+			SEECS_ASSERT(index != tombstone, "Load called on invalid entity with ID " << id);
+
+			T obj{};
+			ForEachColumn([&](const auto& column, auto member) { obj.*member = column[index]; });
+			return obj;
+		}
+
+		// Position of a field among the columns, in soa_fields order
+		template <auto Member>
+		static constexpr size_t ColumnIndex() {
+			constexpr size_t index = IndexOf<Member>(FieldIndices{});
+			static_assert(index < Fields::size, "Field is not listed in soa_fields");
+			return index;
+		}
+
+		// Columns are plain vectors, so every run lasts until the end of the pool
+		size_t ContiguousRun(size_t index) const {
+			return m_denseToEntity.size() - index;
+		}
+
+		/*
+		*  Spans over count fields of every column starting at a dense index,
+		*  this marks the blocks they cover as dirty. See ColumnSpans.
+		*/
+		ColumnSpans<T> ColumnRun(size_t index, size_t count) {
+			for (size_t block = index / DIRTY_BLOCK_SIZE; block * DIRTY_BLOCK_SIZE < index + count; block++)
+				MarkBlockDirty(block);
+			return MakeColumnSpans<ColumnSpans<T>>(m_columns, index, count, FieldIndices{});
+		}
+
+		ColumnSpans<const T> ColumnRun(size_t index, size_t count) const {
+			return MakeColumnSpans<ColumnSpans<const T>>(m_columns, index, count, FieldIndices{});
+		}
+
+		template <auto Member>
+		auto* GetField(EntityID id) {
+			size_t index = GetDenseIndex(id);
+			if (index == tombstone)
+				return static_cast<typename member_traits<decltype(Member)>::field_type*>(nullptr);
+
+			MarkDirty(index);
+			return &std::get<ColumnIndex<Member>()>(m_columns)[index];
+		}
+
+		/*
+		*  Mutable span over a whole column, this marks the entire pool as dirty.
+		*  Aligned to COLUMN_ALIGNMENT bytes.
+		*/
+		template <auto Member>
+		auto Column() {
+			auto& column = std::get<ColumnIndex<Member>()>(m_columns);
+			for (size_t block = 0; block * DIRTY_BLOCK_SIZE < column.size(); block++)
+				MarkBlockDirty(block);
+			return Span<typename member_traits<decltype(Member)>::field_type>{ column.data(), column.size() };
+		}
+
+		template <auto Member>
+		auto Column() const {
+			const auto& column = std::get<ColumnIndex<Member>()>(m_columns);
+			return Span<const typename member_traits<decltype(Member)>::field_type>{ column.data(), column.size() };
+		}
+
+		void Delete(EntityID id) override {
+			size_t deletedIndex = GetDenseIndex(id);
+
+			if (m_denseToEntity.empty() || deletedIndex == tombstone) return;
+
+			SetDenseIndex(m_denseToEntity.back(), deletedIndex);
+			SetDenseIndex(id, tombstone);
+
+			ForEachColumn([deletedIndex](auto& column, auto) {
+				std::swap(column.back(), column[deletedIndex]);
+				column.pop_back();
+			});
+			std::swap(m_denseToEntity.back(), m_denseToEntity[deletedIndex]);
+			m_denseToEntity.pop_back();
+
+			MarkDirty(deletedIndex);
+		}
+
+		void Clear() override {
+			ForEachColumn([](auto& column, auto) { column.clear(); });
+			m_sparsePages.clear();
+			m_sparseView.clear();
+			m_denseToEntity.clear();
+			m_blockEpochs.clear();
+		}
+
+	};
+
+
+
+	/*
+	*  Equality index on a component field, e.g HashIndex<&NetworkId::value>.
+	*  Entities sharing a value are kept in one bucket, lookups are O(1).
+	*  The field type needs std::hash and operator==.
+	*/
+	template <auto Member>
+	class HashIndex : public IComponentIndex<typename member_traits<decltype(Member)>::class_type> {
+	public:
+
+		using Component = typename member_traits<decltype(Member)>::class_type;
+		using Field = typename member_traits<decltype(Member)>::field_type;
+
+	private:
+
+		std::unordered_map<Field, std::vector<EntityID>> m_buckets;
+
+		// Position of every entity inside its bucket
+		SparseSet<size_t> m_slots;
+
+	public:
+
+		void Insert(EntityID id, const Component& component) override {
+			std::vector<EntityID>& bucket = m_buckets[component.*Member];
+			m_slots.Set(id, bucket.size());
+			bucket.push_back(id);
+		}
+
+		void Erase(EntityID id, const Component& component) override {
+			auto it = m_buckets.find(component.*Member);
+			SEECS_ASSERT(it != m_buckets.end(), "Index out of sync, was an indexed field written without Patch()?");
+
+			std::vector<EntityID>& bucket = it->second;
+			size_t slot = std::as_const(m_slots).GetRef(id);
+
+			bucket[slot] = bucket.back();
+			m_slots.Set(bucket[slot], slot);
+			bucket.pop_back();
+			m_slots.Delete(id);
+
+			if (bucket.empty())
+				m_buckets.erase(it);
+		}
+
+		void Clear() override {
+			m_buckets.clear();
+			m_slots.Clear();
+		}
+
+		std::unique_ptr<IComponentIndex<Component>> Clone() const override {
+			return std::make_unique<HashIndex>(*this);
+		}
+
+		// Every entity whose field equals value, invalidated by any change to the pool
+		Span<const EntityID> Find(const Field& value) const {
+			auto it = m_buckets.find(value);
+			if (it == m_buckets.end())
+				return { nullptr, 0 };
+			return { it->second.data(), it->second.size() };
+		}
+
+	};
+
+
+
+	/*
+	*  Ordered index on a component field, e.g OrderedIndex<&Unit::team>.
+	*  Answers equality and range queries in O(log n). The field type needs operator<.
+	*/
+	template <auto Member>
+	class OrderedIndex : public IComponentIndex<typename member_traits<decltype(Member)>::class_type> {
+	public:
+
+		using Component = typename member_traits<decltype(Member)>::class_type;
+		using Field = typename member_traits<decltype(Member)>::field_type;
+
+	private:
+
+		std::set<std::pair<Field, EntityID>> m_entries;
+
+	public:
+
+		void Insert(EntityID id, const Component& component) override {
+			m_entries.insert({ component.*Member, id });
+		}
+
+		void Erase(EntityID id, const Component& component) override {
+			size_t erased = m_entries.erase({ component.*Member, id });
+			SEECS_ASSERT(erased == 1, "Index out of sync, was an indexed field written without Patch()?");
+		}
+
+		void Clear() override {
+			m_entries.clear();
+		}
+
+		std::unique_ptr<IComponentIndex<Component>> Clone() const override {
+			return std::make_unique<OrderedIndex>(*this);
+		}
+
+		// Entities whose field lies within [low, high], in ascending field order
+		std::vector<EntityID> FindRange(const Field& low, const Field& high) const {
+			std::vector<EntityID> result;
+			for (auto it = m_entries.lower_bound({ low, 0 }); it != m_entries.end() && !(high < it->first); ++it)
+				result.push_back(it->second);
+			return result;
+		}
+
+	};
+
+
+
+	// Pool type the ECS stores a component in
+	template <typename T>
+	using ComponentPool = std::conditional_t<is_soa_v<T>, SoASparseSet<T>, SparseSet<T>>;
+
+
+
+	/*
+	*  A SimpleView is a basic implementation of a view, allowing iteration based
+	*  on the passed in Component parameter pack.
+	* 
+	*  Components can be const qualified, e.g SimpleView<const A, B>, in which case they're
+	*  handed out as const references fetched through the pool's const paths. Those never
+	*  write to the pool, so any number of views can read a pool concurrently as long as
+	*  nothing writes to it at the same time (see Scheduler).
+	*/
+	template <typename... Components>
+	class SimpleView {
+	private:
+
+		using componentTypes = type_list<Components...>;
+
+		// SoA components have no T to refer to, only ForEachChunk() can hand them out
+		static constexpr bool HAS_SOA = (is_soa_v<Components> || ...);
+
+		std::array<ISparseSet*, sizeof...(Components)> m_viewPools;
+
+		// Arguments handed to callbacks, with tag components left out since they carry no data
+		template <typename C>
+		using ValueRef = std::conditional_t<is_tag_v<C>, std::tuple<>, std::tuple<C&>>;
+
+		template <typename C>
+		using ValueSpan = std::conditional_t<is_tag_v<C>, std::tuple<>,
+			std::conditional_t<is_soa_v<C>, std::tuple<ColumnSpans<C>>, std::tuple<Span<C>>>>;
+
+		using ValueTuple = decltype(std::tuple_cat(std::declval<ValueRef<Components>>()...));
+		using SpanTuple = decltype(std::tuple_cat(std::declval<ValueSpan<Components>>()...));
+
+		// Sparse set with the smallest number of components,
+		// basis for ForEach iterations.
+		ISparseSet* m_smallest = nullptr;
+
+		/*
+		*	Returns true iff all the pools in the view contain the given Entity
+		*/
+		bool AllContain(EntityID id) {
+			return std::all_of(m_viewPools.begin(), m_viewPools.end(), [id](ISparseSet* pool) {
+				return pool->ContainsEntity(id);
+			});
+		}
+
+		/*
+		*	Index the generic pool array and downcast to a specific component pool
+		*   by using compile time indices
+		*/
+		template <size_t Index>
+		auto GetPoolAt() {
+			using componentType = typename componentTypes::template get<Index>;
+			using poolType = ComponentPool<std::remove_const_t<componentType>>;
+
+			if constexpr (std::is_const_v<componentType>)
+				return static_cast<const poolType*>(m_viewPools[Index]);
+			else
+				return static_cast<poolType*>(m_viewPools[Index]);
+		}
+
+		template <size_t... Indices>
+		auto MakeComponentTuple(EntityID id, std::index_sequence<Indices...>) {
+			return std::make_tuple((std::ref(GetPoolAt<Indices>()->GetRef(id)))...);
+		}
+
+		template <size_t Index>
+		auto MakeValueRef(EntityID id) {
+			using componentType = typename componentTypes::template get<Index>;
+			if constexpr (is_tag_v<componentType>)
+				return std::tuple<>{};
+			else
+				return std::tuple<componentType&>{ GetPoolAt<Index>()->GetRef(id) };
+		}
+
+		// Like MakeComponentTuple, minus tags
+		template <size_t... Indices>
+		ValueTuple MakeValueTuple(EntityID id, std::index_sequence<Indices...>) {
+			return std::tuple_cat(MakeValueRef<Indices>(id)...);
+		}
+
+		// Longest run pool Index can contribute starting at dense index, tags don't limit it
+		template <size_t Index>
+		size_t RunCapacity(size_t denseIndex, size_t remaining) {
+			if constexpr (is_tag_v<typename componentTypes::template get<Index>>)
+				return remaining;
+			else
+				return GetPoolAt<Index>()->ContiguousRun(denseIndex);
+		}
+
+		// Tags only need to contain the entity, everything else has to store it at the expected index
+		template <size_t Index>
+		bool RunContinues(size_t denseIndex, EntityID id) {
+			if constexpr (is_tag_v<typename componentTypes::template get<Index>>)
+				return GetPoolAt<Index>()->GetDenseIndex(id) != SparseSetBase::tombstone;
+			else
+				return GetPoolAt<Index>()->EntityAt(denseIndex) == id;
+		}
+
+		/*
+		*  Length of the run starting at entities[start] that every pool stores at consecutive
+		*  dense indices starting from denseIndices, capped to each pool's contiguous storage.
+		*/
+		template <size_t... Indices>
+		size_t AlignedRunLength(Span<const EntityID> entities, size_t start,
+			const std::array<size_t, sizeof...(Components)>& denseIndices, std::index_sequence<Indices...>) {
+
+			size_t remaining = entities.size - start;
+			size_t maxLength = std::min({ remaining, RunCapacity<Indices>(denseIndices[Indices], remaining)... });
+
+			size_t length = 1;
+			while (length < maxLength &&
+				(RunContinues<Indices>(denseIndices[Indices] + length, entities[start + length]) && ...))
+				length++;
+
+			return length;
+		}
+
+		template <size_t Index>
+		auto MakeValueSpan(size_t denseIndex, size_t length) {
+			using componentType = typename componentTypes::template get<Index>;
+			if constexpr (is_tag_v<componentType>)
+				return std::tuple<>{};
+			else if constexpr (is_soa_v<componentType>)
+				return std::make_tuple(GetPoolAt<Index>()->ColumnRun(denseIndex, length));
+			else
+				return std::make_tuple(GetPoolAt<Index>()->DenseRun(denseIndex, length));
+		}
+
+		template <size_t... Indices>
+		SpanTuple MakeSpanTuple(const std::array<size_t, sizeof...(Components)>& denseIndices, size_t length, std::index_sequence<Indices...>) {
+			return std::tuple_cat(MakeValueSpan<Indices>(denseIndices[Indices], length)...);
+		}
+
+		/*
+		*  Provided the function arguments are valid, this function will iterate over the smallest pool
+		*  and run the lambda on all entities that contain all the components in the view.
+		* 
+		*  Note: This is the internal implementation: opt for the more user friendly functional ones in the
+		*        public interface.
+		*/
+		template <typename Func>
+		void ForEachImpl(Func func) {
+			constexpr auto inds = std::make_index_sequence<sizeof...(Components)>{};
+
+			// Iterate smallest component pool and compare against other pools in view
+			// Note this list is a COPY, allowing safe deletion during iteration.
+			for (EntityID id : m_smallest->GetEntityList())
+				if (AllContain(id))
+					Visit(id, func, inds);
+		}
+
+		// Calls func with the components of an entity known to be in every pool
+		template <typename Func, size_t... Indices>
+		void Visit(EntityID id, Func& func, std::index_sequence<Indices...> inds) {
+			static_assert(!HAS_SOA, "SoA components can't be viewed by reference, use ForEachChunk() or ECS::Columns<T>()");
+
+			// This branch is for [](EntityID id, Component& c1, Component& c2);
+			// constexpr denotes this is evaluated at compile time, which prunes
+			// invalid function call branches before runtime to prevent the
+			// typical invoke errors you'd see after building.
+			if constexpr (std::is_invocable_v<Func, EntityID, Components&...>) {
+				std::apply(func, std::tuple_cat(std::make_tuple(id), MakeComponentTuple(id, inds)));
+			}
+
+			// This branch is for [](Component& c1, Component& c2);
+			else if constexpr (std::is_invocable_v<Func, Components&...>) {
+				std::apply(func, MakeComponentTuple(id, inds));
+			}
+
+			// Same two forms with tag components left out, e.g [](Transform& t) for View<Transform, Enemy>
+			else if constexpr (is_applicable_v<Func, decltype(std::tuple_cat(std::tuple<EntityID>{}, std::declval<ValueTuple>()))>) {
+				std::apply(func, std::tuple_cat(std::make_tuple(id), MakeValueTuple(id, inds)));
+			}
+
+			else if constexpr (is_applicable_v<Func, ValueTuple>) {
+				std::apply(func, MakeValueTuple(id, inds));
+			}
+
+			else {
+				SEECS_ASSERT(false,
+					"Bad lambda provided to .ForEach(), parameter pack does not match lambda args");
+			}
+		}
+
+	public:
+
+		// These are the function signatures you can pass to .ForEach()
+		using ForEachFunc = std::function<void(Components&...)>;
+		using ForEachFuncWithID = std::function<void(EntityID, Components&...)>;
+
+		SimpleView(std::array<ISparseSet*, sizeof...(Components)> pools) :
+			m_viewPools{ pools }
+		{
+			SEECS_ASSERT(componentTypes::size == m_viewPools.size(), "Component type list and pool array size mismatch");
+
+			auto smallestPool = std::min_element(m_viewPools.begin(), m_viewPools.end(),
+				[](ISparseSet* a, ISparseSet* b) { return a->Size() < b->Size(); }
+			);
 
 			SEECS_ASSERT(smallestPool != m_viewPools.end(), "Initializing invalid/empty view");
 
-			m_smallest = *smallestPool;
+			m_smallest = *smallestPool;
+		}
+
+		/*
+		*  Executes a passed lambda on all the entities that match the
+		*  passed parameter pack.
+		*
+		*  Provided function should follow one of two forms:
+		*  [](Component& c1, Component& c2);
+		*  OR
+		*  [](EntityID id, Component& c1, Component& c2);
+		*
+		*  Tag (empty) components can be left out of the arguments,
+		*  e.g View<Transform, Enemy> also accepts [](Transform& t).
+		*/
+		template <typename Func>
+		void ForEach(Func func) {
+			ForEachImpl(func);
+		}
+
+		/*
+		*  Number of entities ForEach() walks over, the size of the smallest pool in the view.
+		*  Some of them are skipped if they lack the other components.
+		*/
+		size_t CandidateCount() {
+			return m_smallest->Size();
+		}
+
+		/*
+		*  ForEach() over the candidates [begin, end) only, to split a view across threads
+		*  (see ParallelReduce() in scheduler.h). The pool is walked directly instead of a
+		*  copy of it, so nothing may be added or removed while it runs.
+		*/
+		template <typename Func>
+		void ForEachInRange(size_t begin, size_t end, Func func) {
+			constexpr auto inds = std::make_index_sequence<sizeof...(Components)>{};
+
+			Span<const EntityID> entities = static_cast<SparseSetBase*>(m_smallest)->Entities();
+			for (size_t i = begin; i < std::min(end, entities.size); i++)
+				if (AllContain(entities[i]))
+					Visit(entities[i], func, inds);
+		}
+
+		/*
+		*  Like ForEach, but hands the lambda whole runs of entities whose components sit at
+		*  consecutive dense indices in every pool of the view, so the body can be written as a
+		*  plain (vectorizable) loop over spans:
+		*
+		*  [](Span<const EntityID> ids, Span<A> a, Span<B> b);
+		*  OR
+		*  [](Span<A> a, Span<B> b);
+		*
+		*  Tag components get no span, they only filter which entities are visited. SoA
+		*  components get a ColumnSpans<T>, spans over the same run of each of their columns.
+		*
+		*  Runs are as long as the pools agree on order, e.g after ECS::SortAs(), and
+		*  break at page boundaries for paged components. Unlike ForEach the spans point
+		*  into the pools themselves, so don't add/remove components while iterating.
+		*/
+		template <typename Func>
+		void ForEachChunk(Func func) {
+			constexpr auto inds = std::make_index_sequence<sizeof...(Components)>{};
+
+			Span<const EntityID> entities = static_cast<SparseSetBase*>(m_smallest)->Entities();
+			std::array<size_t, sizeof...(Components)> denseIndices;
+
+			for (size_t i = 0; i < entities.size;) {
+				bool allContain = true;
+				for (size_t pool = 0; pool < m_viewPools.size(); pool++) {
+					denseIndices[pool] = static_cast<SparseSetBase*>(m_viewPools[pool])->GetDenseIndex(entities[i]);
+					allContain &= denseIndices[pool] != SparseSetBase::tombstone;
+				}
+
+				if (!allContain) {
+					i++;
+					continue;
+				}
+
+				size_t length = AlignedRunLength(entities, i, denseIndices, inds);
+				Span<const EntityID> ids{ entities.data + i, length };
+
+				if constexpr (is_applicable_v<Func, decltype(std::tuple_cat(std::tuple<Span<const EntityID>>{}, std::declval<SpanTuple>()))>) {
+					std::apply(func, std::tuple_cat(std::make_tuple(ids), MakeSpanTuple(denseIndices, length, inds)));
+				}
+				else if constexpr (is_applicable_v<Func, SpanTuple>) {
+					std::apply(func, MakeSpanTuple(denseIndices, length, inds));
+				}
+				else {
+					static_assert(is_applicable_v<Func, SpanTuple>,
+						"Bad lambda provided to .ForEachChunk(), expected Span<Components>... arguments");
+				}
+
+				i += length;
+			}
+		}
+
+		/*
+		*	Holds an entity id and a tuple of references to the components returned by the view.
+		*	Access components that are part of a pack like such:
+		*	- auto [componentA, componentB] = pack.components;
+		*/
+		struct Pack {
+			EntityID id;
+			std::tuple<Components&...> components;
+		};
+
+		/*
+		*  Useful when you want a way to iterate a view via indices.
+		*  e.g:
+			auto packed = ecs.View<A, B>().GetPacked();
+			for (size_t i = 0; i < packed.size(); i++) {
+				auto [a1, b1] = packed[i].components;
+			}
+		*/
+		std::vector<Pack> GetPacked() {
+			static_assert(!HAS_SOA, "SoA components can't be viewed by reference, use ForEachChunk() or ECS::Columns<T>()");
+			constexpr auto inds = std::make_index_sequence<sizeof...(Components)>{};
+			std::vector<Pack> result;
+
+			for (EntityID id : m_smallest->GetEntityList())
+				if (AllContain(id))
+					result.push_back({ id, MakeComponentTuple(id, inds) });
+			return result;
+		}
+
+
+	};
+
+
+
+	/*
+	*  Caches typed pointers to a set of component pools, for random access by ID
+	*  without going through ECS::Get's entity checks and pool lookup every call.
+	*  Each Get is a single sparse page lookup.
+	*
+	*    auto acc = ecs.Accessor<Transform, Health>();
+	*    for (EntityID target : targets)
+	*        acc.Get<Health>(target).value -= 10;
+	*
+	*  Stays valid until ECS::Reset() (pools are never reallocated otherwise),
+	*  but doesn't verify the entity is alive, only that it holds the component.
+	*/
+	template <typename... Components>
+	class ComponentAccessor {
+	private:
+
+		static_assert((!is_soa_v<Components> && ...), "SoA components can't be accessed by reference");
+
+		// Const components are stored as const pools, so they only ever use the read-only paths
+		template <typename T>
+		using PoolPtr = std::conditional_t<std::is_const_v<T>, const SparseSet<std::remove_const_t<T>>*, SparseSet<T>*>;
+
+		std::tuple<PoolPtr<Components>...> m_pools;
+
+		template <typename T>
+		auto GetPool() const {
+			if constexpr ((std::is_same_v<Components, T> || ...))
+				return std::get<PoolPtr<T>>(m_pools);
+			else
+				return std::get<PoolPtr<const T>>(m_pools);
+		}
+
+	public:
+
+		ComponentAccessor(PoolPtr<Components>... pools) :
+			m_pools{ pools... }
+		{}
+
+		// Get<T> works for const components too, returning a const T&
+		template <typename T>
+		auto& Get(EntityID id) {
+			return GetPool<T>()->GetRef(id);
+		}
+
+		// Returns nullptr if the entity doesn't hold the component
+		template <typename T>
+		auto* TryGet(EntityID id) {
+			return GetPool<T>()->Get(id);
+		}
+
+		template <typename... Ts>
+		bool Has(EntityID id) const {
+			return ((GetPool<Ts>()->GetDenseIndex(id) != SparseSetBase::tombstone) && ...);
+		}
+
+	};
+
+
+
+	/*
+	*  Serialized world state produced by ECS::TakeSnapshot()/TakeDeltaSnapshot().
+	*
+	*  A full snapshot can be applied to any world, a delta only onto a world that
+	*  is at baseSequence, i.e one that has applied the snapshot taken right before it.
+	*  Only trivially copyable components can be snapshotted, entity names are not captured.
+	*/
+	struct Snapshot {
+		uint64_t sequence = 0;
+		uint64_t baseSequence = 0;
+		bool isDelta = false;
+		std::vector<uint8_t> bytes;
+	};
+
+
+
+	/*
+	*  Compact binary log of the structural calls made on a world, see ECS::StartRecording().
+	*  Operations are an Op byte followed by varint operands. Components are written as raw bytes
+	*  and matched up by type name on replay, so a trace replays on any build of the same program
+	*  made with the same compiler.
+	*/
+	struct Trace {
+		static constexpr uint32_t MAGIC = 0x43525453;
+		static constexpr uint32_t VERSION = 1;
+
+		enum class Op : uint8_t {
+			Component,   // Recorded index, traced size, name. Precedes the first use of a component
+			Create,      // Entity, name
+			Add,         // Component, entity, raw bytes
+			Remove,      // Component, entity
+			Delete,      // Entity
+			DeleteTree,  // Entity, see ECS::DeleteEntityAndChildren()
+			SetParent,   // Child, parent + 1 (so NULL_ENTITY is 0)
+			Clone,       // Source, count, then the created entities
+			Frame
+		};
+
+		std::vector<uint8_t> bytes;
+	};
+
+
+
+	// Writer slots of the threads emitting events, given back when a thread exits
+	class EventWriterSlots {
+	private:
+
+		std::mutex m_mutex;
+		std::vector<size_t> m_free;
+		size_t m_next = 0;
+
+	public:
+
+		static EventWriterSlots& Get() {
+			static EventWriterSlots slots;
+			return slots;
+		}
+
+		// MAX_EVENT_WRITERS once every slot is taken
+		size_t Acquire() {
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			if (!m_free.empty()) {
+				size_t index = m_free.back();
+				m_free.pop_back();
+				return index;
+			}
+			return (m_next < MAX_EVENT_WRITERS) ? m_next++ : MAX_EVENT_WRITERS;
+		}
+
+		void Release(size_t index) {
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			m_free.push_back(index);
+		}
+	};
+
+	// Small index of the calling thread, taken when it first emits an event
+	inline size_t EventWriterIndex() {
+		struct Slot {
+			size_t index = EventWriterSlots::Get().Acquire();
+			~Slot() {
+				if (index < MAX_EVENT_WRITERS)
+					EventWriterSlots::Get().Release(index);
+			}
+		};
+
+		thread_local Slot slot;
+		return slot.index;
+	}
+
+	class IEventChannel {
+	public:
+		virtual ~IEventChannel() = default;
+		virtual void Update() = 0;
+		virtual void Clear() = 0;
+		virtual std::unique_ptr<IEventChannel> Clone() const = 0;
+		virtual void CopyFrom(const IEventChannel& other) = 0;
+	};
+
+	/*
+	*  Double-buffered queue for one type of event, see ECS::Emit().
+	*
+	*  Every thread appends to its own writer (past MAX_EVENT_WRITERS threads, the rest share a
+	*  locked one), Update() then moves the frame's events into the readable buffer, writer by
+	*  writer. Buffers are cleared rather than freed, so once they've grown to fit the busiest
+	*  frame, emitting no longer allocates.
+	*/
+	template <typename E>
+	class EventChannel : public IEventChannel {
+	private:
+
+		// A cache line each, so threads emitting at the same time don't contend
+		struct alignas(64) Writer {
+			std::vector<E> events;
+		};
+
+		// The last writer is shared by threads that didn't get one of their own
+		std::array<Writer, MAX_EVENT_WRITERS + 1> m_writers;
+		std::mutex m_sharedMutex;
+		std::vector<E> m_read;
+
+	public:
+
+		void Emit(E&& event) {
+			size_t writer = EventWriterIndex();
+			if (writer < MAX_EVENT_WRITERS) {
+				m_writers[writer].events.push_back(std::move(event));
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock{ m_sharedMutex };
+			m_writers[MAX_EVENT_WRITERS].events.push_back(std::move(event));
+		}
+
+		Span<const E> Read() const {
+			return { m_read.data(), m_read.size() };
+		}
+
+		void Update() override {
+			m_read.clear();
+
+			Writer* only = nullptr;
+			size_t used = 0;
+			for (Writer& writer : m_writers) {
+				if (!writer.events.empty()) {
+					only = &writer;
+					used++;
+				}
+			}
+
+			// A single writer hands its buffer over, the writer keeps the old one's capacity
+			if (used == 1) {
+				std::swap(m_read, only->events);
+				return;
+			}
+
+			for (Writer& writer : m_writers) {
+				m_read.insert(m_read.end(), std::make_move_iterator(writer.events.begin()), std::make_move_iterator(writer.events.end()));
+				writer.events.clear();
+			}
+		}
+
+		void Clear() override {
+			m_read.clear();
+			for (Writer& writer : m_writers)
+				writer.events.clear();
+		}
+
+		std::unique_ptr<IEventChannel> Clone() const override {
+			auto copy = std::make_unique<EventChannel>();
+			copy->CopyFrom(*this);
+			return copy;
+		}
+
+		void CopyFrom(const IEventChannel& other) override {
+			if (&other == this) return;
+			const EventChannel& source = static_cast<const EventChannel&>(other);
+
+			if constexpr (std::is_copy_assignable_v<E>) {
+				m_read = source.m_read;
+				for (size_t i = 0; i < m_writers.size(); i++)
+					m_writers[i].events = source.m_writers[i].events;
+			}
+			else {
+				SEECS_ASSERT(false, "Can't fork a world holding the non-copyable event '" << typeid(E).name() << "'");
+			}
+		}
+
+	};
+
+
+
+	/*
+	*  Built-in parent/child relation, managed through ECS::SetParent() and friends.
+	*  Children form an intrusive doubly linked list hanging off their parent.
+	*
+	*  The pool is kept sorted by depth, so ECS::HierarchyOrder() lists every
+	*  parent before its children. Don't write to this component directly.
+	*/
+	struct Hierarchy {
+		EntityID parent = NULL_ENTITY;
+		EntityID firstChild = NULL_ENTITY;
+		EntityID nextSibling = NULL_ENTITY;
+		EntityID prevSibling = NULL_ENTITY;
+		uint32_t depth = 0;
+		uint32_t childCount = 0;
+	};
+
+
+
+	/*
+	*  Memory resource backing storage with huge pages, which cuts the dTLB misses of random
+	*  access (Get() and the sparse lookups behind it) into large pools. It can also bind its
+	*  memory to a NUMA node, so the threads of one socket get local memory:
+	*
+	*    seecs::HugePageResource local{ 0 };                   // Node 0, or HugePageResource::ANY_NODE
+	*    seecs::ECS ecs{ &local };                             // The whole world
+	*    ecs.SetPoolMemoryResource<Transform>(&otherNode);     // Or a single pool
+	*
+	*  On Linux, memory is mapped with MAP_HUGETLB while reserved huge pages (vm.nr_hugepages)
+	*  last, and is otherwise madvise(MADV_HUGEPAGE)'d for transparent huge pages. Binding uses
+	*  mbind(MPOL_BIND) before the memory is first touched, FailedBinds() counts mappings the
+	*  kernel refused to bind. Other platforms get huge page aligned heap memory.
+	*
+	*  Requests of half a huge page or more get mappings of their own, smaller ones are packed
+	*  into shared huge pages and recycled through pools. The shared pages are unmapped
+	*  with the resource, which has to outlive everything allocated from it.
+	*/
+	class HugePageResource : public std::pmr::memory_resource {
+	public:
+
+		static constexpr int ANY_NODE = -1;
+
+	private:
+
+		// Maps huge pages for the pools: whole mappings for big requests, slices of a shared page for the rest
+		class Mapper : public std::pmr::memory_resource {
+		private:
+
+			static constexpr size_t DEDICATED_BYTES = HUGE_PAGE_BYTES / 2;
+
+			int m_node;
+
+			// Cleared on the first MAP_HUGETLB failure, so exhausted reserves aren't retried every time
+			std::atomic<bool> m_hugeTlb{ true };
+			std::atomic<size_t> m_failedBinds{ 0 };
+			std::atomic<size_t> m_mappedBytes{ 0 };
+
+			std::mutex m_mutex;
+			std::vector<void*> m_sharedPages;
+			unsigned char* m_cursor = nullptr;
+			size_t m_remaining = 0;
+
+			static size_t RoundUp(size_t bytes) {
+				return (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+			}
+
+			void Bind(void* ptr, size_t bytes) {
+#if defined(__linux__) && defined(SYS_mbind)
+				// mbind(2) through syscall(), so libnuma isn't needed. 2 is MPOL_BIND from <numaif.h>.
+				constexpr long BIND_POLICY = 2;
+				constexpr size_t MASK_WORDS = 16;
+				constexpr size_t BITS = sizeof(unsigned long) * 8;
+
+				SEECS_ASSERT(size_t(m_node) < MASK_WORDS * BITS, "NUMA node " << m_node << " out of range");
+				unsigned long mask[MASK_WORDS] = {};
+				mask[m_node / BITS] = 1ul << (m_node % BITS);
+
+				if (syscall(SYS_mbind, ptr, bytes, BIND_POLICY, mask, MASK_WORDS * BITS + 1, 0) != 0)
+					m_failedBinds++;
+#else
+				m_failedBinds++;
+#endif
+			}
+
+			// Maps bytes, a multiple of HUGE_PAGE_BYTES, aligned to a huge page
+			void* Map(size_t bytes) {
+#if defined(__linux__)
+				void* ptr = MAP_FAILED;
+	#ifdef MAP_HUGETLB
+				if (m_hugeTlb) {
+					ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+					if (ptr == MAP_FAILED)
+						m_hugeTlb = false;
+				}
+	#endif
+				if (ptr == MAP_FAILED) {
+					// Over-mapped by a huge page and trimmed, transparent huge pages need aligned ranges
+					size_t mapped = bytes + HUGE_PAGE_BYTES;
+					void* raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+					if (raw == MAP_FAILED)
+						throw std::bad_alloc();
+
+					unsigned char* begin = static_cast<unsigned char*>(raw);
+					unsigned char* aligned = begin + (HUGE_PAGE_BYTES - reinterpret_cast<uintptr_t>(begin) % HUGE_PAGE_BYTES) % HUGE_PAGE_BYTES;
+					if (aligned != begin)
+						munmap(begin, aligned - begin);
+					if (begin + mapped != aligned + bytes)
+						munmap(aligned + bytes, (begin + mapped) - (aligned + bytes));
+
+					ptr = aligned;
+	#ifdef MADV_HUGEPAGE
+					madvise(ptr, bytes, MADV_HUGEPAGE);
+	#endif
+				}
+
+				if (m_node != ANY_NODE)
+					Bind(ptr, bytes);
+#else
+				void* ptr = ::operator new(bytes, std::align_val_t{ HUGE_PAGE_BYTES });
+				if (m_node != ANY_NODE)
+					Bind(ptr, bytes);
+#endif
+				m_mappedBytes += bytes;
+				return ptr;
+			}
+
+			void Unmap(void* ptr, size_t bytes) {
+#if defined(__linux__)
+				munmap(ptr, bytes);
+#else
+				::operator delete(ptr, std::align_val_t{ HUGE_PAGE_BYTES });
+#endif
+				m_mappedBytes -= bytes;
+			}
+
+			void* do_allocate(size_t bytes, size_t alignment) override {
+				SEECS_ASSERT(alignment <= HUGE_PAGE_BYTES, "Alignment " << alignment << " is larger than a huge page");
+
+				if (bytes >= DEDICATED_BYTES)
+					return Map(RoundUp(bytes));
+
+				std::lock_guard<std::mutex> lock{ m_mutex };
+
+				size_t padding = m_cursor ? (alignment - reinterpret_cast<uintptr_t>(m_cursor) % alignment) % alignment : 0;
+				if (!m_cursor || padding + bytes > m_remaining) {
+					m_cursor = static_cast<unsigned char*>(Map(HUGE_PAGE_BYTES));
+					m_sharedPages.push_back(m_cursor);
+					m_remaining = HUGE_PAGE_BYTES;
+					padding = 0;
+				}
+
+				void* ptr = m_cursor + padding;
+				m_cursor += padding + bytes;
+				m_remaining -= padding + bytes;
+				return ptr;
+			}
+
+			// Slices of shared pages are recycled by the pools, and unmapped with the resource
+			void do_deallocate(void* ptr, size_t bytes, size_t) override {
+				if (bytes >= DEDICATED_BYTES)
+					Unmap(ptr, RoundUp(bytes));
+			}
+
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+				return this == &other;
+			}
+
+		public:
+
+			explicit Mapper(int node) :
+				m_node{ node }
+			{}
+
+			~Mapper() {
+				for (void* page : m_sharedPages)
+					Unmap(page, HUGE_PAGE_BYTES);
+			}
+
+			size_t FailedBinds() const {
+				return m_failedBinds;
+			}
+
+			size_t MappedBytes() const {
+				return m_mappedBytes;
+			}
+
+		};
+
+		Mapper m_mapper;
+		std::pmr::synchronized_pool_resource m_pools;
+
+		void* do_allocate(size_t bytes, size_t alignment) override {
+			return m_pools.allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+			m_pools.deallocate(ptr, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+
+	public:
+
+		explicit HugePageResource(int node = ANY_NODE) :
+			m_mapper{ node },
+			m_pools{ std::pmr::pool_options{ 0, HUGE_PAGE_BYTES / 2 }, &m_mapper }
+		{}
+
+		HugePageResource(const HugePageResource&) = delete;
+		HugePageResource& operator=(const HugePageResource&) = delete;
+
+		// Mappings the kernel refused to bind to the requested NUMA node
+		size_t FailedBinds() const {
+			return m_mapper.FailedBinds();
+		}
+
+		// Bytes currently mapped, including the unused parts of shared pages and of rounded up mappings
+		size_t MappedBytes() const {
+			return m_mapper.MappedBytes();
+		}
+
+	};
+
+
+
+	/*
+	*  A single preallocated block a whole world can live in, freed in one go:
+	*
+	*    seecs::WorldArena arena{ 256 << 20 };
+	*    seecs::ECS ecs{ &arena };
+	*
+	*  The block comes from upstream (e.g a HugePageResource) and is carved up by a monotonic
+	*  resource, with a pool resource on top recycling freed memory (vectors that grew, pages of
+	*  deleted components). Once the block runs out the arena grows from upstream, or throws
+	*  std::bad_alloc when it isn't growable. Release() drops everything allocated at once so the
+	*  block can be reused, the worlds living in the arena must be gone by then. Destroying the
+	*  arena hands the block back to upstream with a single deallocation.
+	*
+	*  Allocation is thread safe, since forked paged pools copy pages on write from systems.
+	*/
+	class WorldArena : public std::pmr::memory_resource {
+	private:
+
+		// Requests past this many bytes skip the pools and go straight to the block
+		static constexpr size_t LARGEST_POOLED_BLOCK = 64 * 1024;
+
+		std::pmr::memory_resource* m_upstream;
+		size_t m_capacity;
+		void* m_block;
+		std::pmr::monotonic_buffer_resource m_monotonic;
+		std::pmr::synchronized_pool_resource m_pools;
+
+		void* do_allocate(size_t bytes, size_t alignment) override {
+			return m_pools.allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+			m_pools.deallocate(ptr, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+
+	public:
+
+		explicit WorldArena(size_t capacity, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource(), bool growable = true) :
+			m_upstream{ upstream },
+			m_capacity{ capacity },
+			m_block{ upstream->allocate(capacity) },
+			m_monotonic{ m_block, capacity, growable ? upstream : std::pmr::null_memory_resource() },
+			m_pools{ std::pmr::pool_options{ 0, LARGEST_POOLED_BLOCK }, &m_monotonic }
+		{}
+
+		~WorldArena() {
+			Release();
+			m_upstream->deallocate(m_block, m_capacity);
+		}
+
+		WorldArena(const WorldArena&) = delete;
+		WorldArena& operator=(const WorldArena&) = delete;
+
+		void Release() {
+			m_pools.release();
+			m_monotonic.release();
+		}
+
+		size_t Capacity() const {
+			return m_capacity;
+		}
+
+	};
+
+
+
+	class Prefab;
+	class ThreadPool;
+
+	// Interned name of an entity, see ECS::CreateEntity()
+	struct EntityName {
+		uint32_t id;
+	};
+
+
+
+	class ECS {
+	private:
+
+		friend class CommandBuffer;
+		friend class Prefab;
+
+		// Each bit in the mask represents a component,
+		// '1' == active, '0' == inactive.
+		using ComponentMask = std::bitset<MAX_COMPONENTS>;
+
+
+		// Where the entity lists and pools allocate from, see ECS(memory_resource*)
+		std::pmr::memory_resource* m_resource;
+
+
+		// List of IDs already created, but no longer in use
+		std::pmr::vector<EntityID> m_availableEntities{ m_resource };
+
+
+		// Holds the component mask for an entity
+		SparseSet<ComponentMask> m_entityMasks{ m_resource };
+
+
+		// Associates ID with name provided in CreateEntity(), mainly for debugging.
+		// Names are interned, entities only store the index into m_nameTable.
+		SparseSet<EntityName> m_entityNames{ m_resource };
+
+		// Deque so string_views handed out stay valid as names are added
+		std::deque<std::string> m_nameTable;
+		std::unordered_map<std::string_view, uint32_t> m_nameIDs;
+
+		// Entities per name ID, for FindEntity()
+		HashIndex<&EntityName::id>* m_entitiesByName = nullptr;
+
+		// Changes whenever a name is added, worlds with the same version have identical
+		// name tables, which lets RestoreFrom() skip copying them.
+		uint64_t m_nameTableVersion = 0;
+
+
+		// Holds generic pointers to specific component sparse sets.
+		// 
+		// Index into this array using the corresponding bit position
+		// found by using m_componentBitPosition
+		std::vector<std::unique_ptr<ISparseSet>> m_componentPools;
+
+
+		// Singleton resources (Time, Input, ...), indexed by GetResourceIndex<T>().
+		// m_resourceData mirrors the slots so Resource<T>() is a single lookup.
+		struct IResourceSlot {
+			virtual ~IResourceSlot() = default;
+			virtual std::unique_ptr<IResourceSlot> Clone() const = 0;
+			// Copies the value of a slot of the same type, false when it isn't copy assignable
+			virtual bool AssignFrom(const IResourceSlot& other) = 0;
+			virtual void* Data() = 0;
+		};
+
+		template <typename T>
+		struct ResourceSlot : IResourceSlot {
+			T value;
+			ResourceSlot(T&& value) : value{ std::move(value) } {}
+
+			std::unique_ptr<IResourceSlot> Clone() const override {
+				if constexpr (std::is_copy_constructible_v<T>) {
+					T copy = value;
+					return std::make_unique<ResourceSlot>(std::move(copy));
+				}
+				else {
+					SEECS_ASSERT(false, "Can't fork a world holding the non-copyable resource '" << typeid(T).name() << "'");
+					return nullptr;
+				}
+			}
+
+			bool AssignFrom(const IResourceSlot& other) override {
+				if constexpr (std::is_copy_assignable_v<T>) {
+					value = static_cast<const ResourceSlot&>(other).value;
+					return true;
+				}
+				else {
+					return false;
+				}
+			}
+
+			void* Data() override {
+				return &value;
+			}
+		};
+
+		std::vector<std::unique_ptr<IResourceSlot>> m_resources;
+		std::vector<void*> m_resourceData;
+
+
+		// Event channels, indexed by GetEventIndex<E>()
+		std::vector<std::unique_ptr<IEventChannel>> m_eventChannels;
+
+
+		// Helpful little vector that associates component index with a name
+		// Just for debugging.
+		inline static std::vector<std::string> m_componentNames;
+
+
+		// Creates an empty pool for the component at the same index,
+		// used when applying snapshots to a world that hasn't seen a component yet.
+		using PoolFactory = std::unique_ptr<ISparseSet>(*)(std::pmr::memory_resource*);
+		inline static std::vector<PoolFactory> m_poolFactories;
+
+
+		// Epoch each pool was at when the last snapshot was taken,
+		// anything written at or after it goes into the next delta.
+		std::vector<uint64_t> m_snapshotEpochs;
+		uint64_t m_maskSnapshotEpoch = 0;
+		uint64_t m_snapshotSequence = 0;
+
+
+		// Highest recorded entity ID
+		std::atomic<EntityID> m_maxEntityID{ 0 };
+
+		// IDs are never handed out past this, see SetEntityCapacity()
+		size_t m_entityCapacity = MAX_ENTITIES;
+
+
+		// Number of IDs ReserveEntities() handed out from the back of m_availableEntities
+		// since the last FlushReservations(). Lets any thread reserve IDs without a lock.
+		std::atomic<size_t> m_recycleCursor{ 0 };
+
+
+		// See SetDeterministic(). The free list is sorted lazily, m_freeListSorted
+		// tracks whether IDs were freed since the last sort.
+		bool m_deterministic = false;
+		bool m_freeListSorted = true;
+
+		// Trace being recorded, see StartRecording(), and which components it has a type entry for
+		Trace* m_trace = nullptr;
+		std::vector<bool> m_tracedComponents;
+
+
+#define ENTITY_INFO(id) \
+			"['" << GetEntityName(id) << "', ID: " << id << "]"
+
+#define SEECS_ASSERT_VALID_ENTITY(id) \
+			SEECS_ASSERT(id != NULL_ENTITY, "NULL_ENTITY cannot be operated on by the ECS") \
+			SEECS_ASSERT(id < m_maxEntityID && id >= 0, "Invalid entity ID out of bounds: " << id);
+
+#define SEECS_ASSERT_ALIVE_ENTITY(id) \
+			SEECS_ASSERT(m_entityMasks.ContainsEntity(id), "Attempting to access inactive entity with ID: " << id);
+
+	private:
+
+		static size_t GetNextComponentIndex(std::string typeName, PoolFactory factory) {
+			static size_t ind = 0;
+			m_componentNames.push_back(typeName);
+			m_poolFactories.push_back(factory);
+			return ind++;
+		};
+
+		template <typename T>
+		static std::unique_ptr<ISparseSet> CreatePool(std::pmr::memory_resource* resource) {
+			return std::make_unique<ComponentPool<T>>(resource);
+		}
+
+		// Returns a unique ID for each type, used to index component pools
+		// - Since it's static, all ECS instances share the same index for each component type.
+        template <typename T>
+        static size_t GetComponentIndex() {
+			static size_t ind = GetNextComponentIndex(typeid(T).name(), &CreatePool<T>);
+            return ind;
+        };
+
+		static uint64_t NextNameTableVersion() {
+			static std::atomic<uint64_t> version{ 0 };
+			return ++version;
+		}
+
+		static size_t GetNextResourceIndex() {
+			static size_t ind = 0;
+			return ind++;
+		}
+
+		// Like GetComponentIndex, but for resources, which are numbered separately
+		template <typename T>
+		static size_t GetResourceIndex() {
+			static size_t ind = GetNextResourceIndex();
+			return ind;
+		}
+
+		static size_t GetNextEventIndex() {
+			static size_t ind = 0;
+			return ind++;
+		}
+
+		template <typename E>
+		static size_t GetEventIndex() {
+			static size_t ind = GetNextEventIndex();
+			return ind;
+		}
+
+		template <typename E>
+		EventChannel<E>& GetEventChannel() {
+			size_t index = GetEventIndex<E>();
+			if (index >= m_eventChannels.size())
+				m_eventChannels.resize(index + 1);
+			if (!m_eventChannels[index])
+				m_eventChannels[index] = std::make_unique<EventChannel<E>>();
+
+			return *static_cast<EventChannel<E>*>(m_eventChannels[index].get());
+		}
+
+		// Same as GetComponentTypeIndex, but will register if the component doesn't exist yet.
+		template <typename T>
+		size_t GetOrRegisterComponentIndex() {
+			size_t index = GetComponentIndex<T>();
+
+			if (index >= m_componentPools.size() || !m_componentPools[index])
+				RegisterComponent<T>();
+
+			// Internal error, should never happen outside development
+			SEECS_ASSERT(index < m_componentPools.size() && index >= 0,
+				"Type index out of bounds for component '" << typeid(T).name() << "'");
+
+			return index;
+		}
+
+		// Pools of fixed capacity worlds start out with room for every entity, see SetEntityCapacity()
+		std::unique_ptr<ISparseSet> NewPool(size_t index, std::pmr::memory_resource* resource) {
+			std::unique_ptr<ISparseSet> pool = m_poolFactories[index](resource);
+			if (IsFixedCapacity())
+				pool->Reserve(m_entityCapacity, m_entityCapacity);
+			return pool;
+		}
+
+		/*
+		*   Retrieves an uncasted pointer to a pool of type T
+		*/
+		template <typename T>
+		ISparseSet* GetComponentPoolPtr() {
+			size_t index = GetOrRegisterComponentIndex<T>();
+			return m_componentPools[index].get();
+		}
+
+		/*
+		* Retrieves reference for the specific component pool given a component name
+		*/
+		template <typename T>
+		ComponentPool<T>& GetComponentPool() {
+			ISparseSet* genericPtr = GetComponentPoolPtr<T>();
+			ComponentPool<T>* pool = static_cast<ComponentPool<T>*>(genericPtr);
+
+			return *pool;
+		}
+
+		template <typename Component>
+		void SetComponentBit(ComponentMask& mask, bool val) {
+			size_t bitPos = GetComponentIndex<Component>();
+			mask[bitPos] = val;
+		}
+
+		template <typename Component>
+		ComponentMask::reference GetComponentBit(ComponentMask& mask) {
+			size_t bitPos = GetComponentIndex<Component>();
+			return mask[bitPos];
+		}
+
+		ComponentMask& GetEntityMask(EntityID id) {
+			ComponentMask* mask = m_entityMasks.Get(id);
+			SEECS_ASSERT(mask, "Entity " << ENTITY_INFO(id) << " has no component mask");
+			return *mask;
+		}
+
+		/*
+		*  Assembles a generic mask for the given components
+		*/
+		template <typename... Components>
+		ComponentMask GetMask() {
+			ComponentMask mask;
+			(SetComponentBit<Components>(mask, 1), ...);
+			return mask;
+		}
+
+		/*
+		*  Reserves count entity IDs without creating the entities, writing them to out.
+		*  Lock-free and safe to call from any number of threads at once, but not alongside
+		*  anything else that touches entities (CreateEntity, DeleteEntity, ...).
+		*
+		*  Only CommandBuffer reserves IDs: it turns them into entities when committed, and
+		*  returns the ones it didn't use to the free list when committed or destroyed.
+		*  Which thread gets which ID depends on timing, which is why command buffers
+		*  don't reserve IDs in deterministic mode (see SetDeterministic()).
+		*/
+		void ReserveEntities(size_t count, EntityID* out) {
+			size_t first = m_recycleCursor.fetch_add(count, std::memory_order_relaxed);
+			size_t available = m_availableEntities.size();
+
+			size_t recycled = (first < available) ? std::min(count, available - first) : 0;
+			for (size_t i = 0; i < recycled; i++)
+				out[i] = m_availableEntities[available - 1 - (first + i)];
+
+			size_t fresh = count - recycled;
+			if (fresh == 0) return;
+
+			EntityID id = m_maxEntityID.fetch_add(fresh, std::memory_order_relaxed);
+			SEECS_ASSERT(id + fresh <= m_entityCapacity && id + fresh > id, "Entity limit exceeded");
+			for (size_t i = 0; i < fresh; i++)
+				out[recycled + i] = id + i;
+		}
+
+		/*
+		*  Drops the IDs reserved from the free list since the last call.
+		*  Must only run at a sync point, when no thread is reserving IDs.
+		*/
+		void FlushReservations() {
+			size_t used = std::min(m_recycleCursor.exchange(0), m_availableEntities.size());
+			m_availableEntities.resize(m_availableEntities.size() - used);
+
+			// Lowest IDs last, since IDs are recycled from the back. Usually only the
+			// IDs freed since the last sort are out of order, so they're merged in.
+			if (m_deterministic && !m_freeListSorted) {
+				auto unsorted = std::is_sorted_until(m_availableEntities.begin(), m_availableEntities.end(), std::greater<EntityID>());
+				std::sort(unsorted, m_availableEntities.end(), std::greater<EntityID>());
+
+				// inplace_merge() allocates a buffer, which fixed capacity worlds can't
+				if (IsFixedCapacity())
+					std::sort(m_availableEntities.begin(), m_availableEntities.end(), std::greater<EntityID>());
+				else
+					std::inplace_merge(m_availableEntities.begin(), unsorted, m_availableEntities.end(), std::greater<EntityID>());
+				m_freeListSorted = true;
+			}
+		}
+
+		/*
+		*  Deletes an entity and its components, ignoring its Hierarchy links
+		*/
+		void DestroyEntity(EntityID& id) {
+			[[maybe_unused]] std::string_view name = GetEntityName(id);
+			ComponentMask& mask = GetEntityMask(id);
+
+			// Destroy component associations
+			for (int i = 0; i < MAX_COMPONENTS; i++)
+				if (mask[i] == 1)
+					m_componentPools[i]->Delete(id);
+
+			m_entityMasks.Delete(id);
+			m_entityNames.Delete(id);
+			m_availableEntities.push_back(id);
+			m_freeListSorted = false;
+
+			SEECS_INFO("Deleted entity ['" << name << "', ID: " << id << "]");
+			id = NULL_ENTITY;
+		}
+
+		ComponentPool<Hierarchy>& GetHierarchyPool() {
+			ComponentPool<Hierarchy>& pool = GetComponentPool<Hierarchy>();
+			if (!pool.IsKeptSorted())
+				pool.KeepSorted([](const Hierarchy& a, const Hierarchy& b) { return a.depth < b.depth; });
+			return pool;
+		}
+
+		// Removes an entity from its parent's child list, keeping its own children
+		void Unlink(EntityID id) {
+			ComponentPool<Hierarchy>& pool = GetHierarchyPool();
+			Hierarchy& node = pool.GetRef(id);
+			if (node.parent == NULL_ENTITY) return;
+
+			if (node.prevSibling != NULL_ENTITY)
+				pool.GetRef(node.prevSibling).nextSibling = node.nextSibling;
+			else
+				pool.GetRef(node.parent).firstChild = node.nextSibling;
+
+			if (node.nextSibling != NULL_ENTITY)
+				pool.GetRef(node.nextSibling).prevSibling = node.prevSibling;
+
+			pool.GetRef(node.parent).childCount--;
+			node.parent = NULL_ENTITY;
+			node.nextSibling = NULL_ENTITY;
+			node.prevSibling = NULL_ENTITY;
+		}
+
+		// Sets the depth of an entity, updating its whole subtree
+		void SetDepth(EntityID id, uint32_t depth) {
+			ComponentPool<Hierarchy>& pool = GetHierarchyPool();
+			pool.GetRef(id).depth = depth;
+
+			for (EntityID descendant : GetDescendants(id)) {
+				Hierarchy& node = pool.GetRef(descendant);
+				node.depth = pool.GetRef(node.parent).depth + 1;
+			}
+		}
+
+		static void AppendChildren(const ComponentPool<Hierarchy>& pool, EntityID id, std::vector<EntityID>& out) {
+			for (EntityID child = pool.GetRef(id).firstChild; child != NULL_ENTITY; child = pool.GetRef(child).nextSibling)
+				out.push_back(child);
+		}
+
+		// Returns the ID of a name in m_nameTable, adding it on first use
+		uint32_t InternName(std::string_view name) {
+			auto it = m_nameIDs.find(name);
+			if (it != m_nameIDs.end())
+				return it->second;
+
+			SEECS_ASSERT(m_nameTable.size() < std::numeric_limits<uint32_t>::max(), "Too many unique entity names");
+
+			uint32_t nameID = static_cast<uint32_t>(m_nameTable.size());
+			m_nameTable.emplace_back(name);
+			m_nameIDs.emplace(m_nameTable.back(), nameID);
+			m_nameTableVersion = NextNameTableVersion();
+			return nameID;
+		}
+
+		/*
+		*  Whether count more entities with the components in mask fit within the capacities
+		*  set by SetEntityCapacity() and SetPoolCapacity(). Pools not created yet have room.
+		*/
+		Result CheckRoom(size_t count, const ComponentMask& mask) {
+			FlushReservations();
+
+			if (count > m_availableEntities.size() + (m_entityCapacity - m_maxEntityID))
+				return Result::EntityLimit;
+
+			for (size_t i = 0; i < m_componentPools.size(); i++)
+				if (mask[i] && m_componentPools[i] && m_componentPools[i]->Size() + count > m_componentPools[i]->Capacity())
+					return Result::PoolFull;
+			return Result::Ok;
+		}
+
+		/*
+		*  Creates count unnamed entities sharing a component mask, without attaching
+		*  any component data (the caller fills the pools in bulk).
+		*/
+		std::vector<EntityID> AllocateEntities(size_t count, const ComponentMask& mask) {
+			FlushReservations();
+
+			std::vector<EntityID> ids(count);
+			size_t recycled = std::min(count, m_availableEntities.size());
+			for (size_t i = 0; i < recycled; i++) {
+				ids[i] = m_availableEntities.back();
+				m_availableEntities.pop_back();
+			}
+
+			size_t fresh = count - recycled;
+			SEECS_ASSERT(m_maxEntityID + fresh <= m_entityCapacity && m_maxEntityID + fresh >= m_maxEntityID, "Entity limit exceeded");
+			EntityID first = m_maxEntityID.fetch_add(fresh);
+			for (size_t i = 0; i < fresh; i++)
+				ids[recycled + i] = first + i;
+
+			m_entityMasks.Fill(ids.data(), count, mask);
+
+			SEECS_INFO("Created " << count << " entities");
+			return ids;
+		}
+
+		/*
+		*  Turns a reserved ID into a live entity
+		*/
+		void MaterializeEntity(EntityID id, std::string_view name) {
+			SEECS_ASSERT(id != NULL_ENTITY, "Cannot create entity with null ID");
+
+			m_entityMasks.Set(id, {});
+
+			if (!name.empty())
+				m_entityNames.Set(id, { InternName(name) });
+
+			if (m_trace) {
+				Record(Trace::Op::Create, { id, name.size() });
+				SnapshotWriter{ m_trace->bytes }.WriteBytes(name.data(), name.size());
+			}
+
+			SEECS_INFO("Created entity " << ENTITY_INFO(id));
+		}
+
+		// Appends an operation to the trace being recorded
+		void Record(Trace::Op op, std::initializer_list<uint64_t> operands) {
+			SnapshotWriter writer{ m_trace->bytes };
+			writer.Write(op);
+			for (uint64_t operand : operands)
+				writer.WriteVarint(operand);
+		}
+
+		// Records a component operation, bytes holds the component for Add
+		void RecordComponent(Trace::Op op, size_t index, EntityID id, const void* bytes = nullptr) {
+			if (index >= m_tracedComponents.size())
+				m_tracedComponents.resize(index + 1, false);
+
+			size_t size = m_componentPools[index]->TracedSize();
+			if (!m_tracedComponents[index]) {
+				const std::string& name = m_componentNames[index];
+				Record(Trace::Op::Component, { index, size, name.size() });
+				SnapshotWriter{ m_trace->bytes }.WriteBytes(name.data(), name.size());
+				m_tracedComponents[index] = true;
+			}
+
+			Record(op, { index, id });
+			if (bytes)
+				SnapshotWriter{ m_trace->bytes }.WriteBytes(bytes, size);
+		}
+
+		// Keeps the calls a recorded call makes internally out of the trace
+		class RecordingPause {
+		private:
+			ECS& m_ecs;
+			Trace* m_trace;
+
+		public:
+			RecordingPause(ECS& ecs) :
+				m_ecs{ ecs },
+				m_trace{ ecs.m_trace }
+			{
+				ecs.m_trace = nullptr;
+			}
+
+			~RecordingPause() {
+				m_ecs.m_trace = m_trace;
+			}
+		};
+
+		Snapshot WriteSnapshot(bool delta) {
+			FlushReservations();
+
+			Snapshot snapshot;
+			snapshot.isDelta = delta;
+			snapshot.baseSequence = delta ? m_snapshotSequence : 0;
+			snapshot.sequence = ++m_snapshotSequence;
+
+			SnapshotWriter writer{ snapshot.bytes };
+
+			writer.Write<uint64_t>(m_maxEntityID);
+			writer.Write<uint64_t>(m_availableEntities.size());
+			writer.WriteBytes(m_availableEntities.data(), m_availableEntities.size() * sizeof(EntityID));
+
+			m_entityMasks.Serialize(writer, delta ? m_maskSnapshotEpoch : 0);
+			m_maskSnapshotEpoch = m_entityMasks.AdvanceEpoch();
+
+			m_snapshotEpochs.resize(m_componentPools.size(), 0);
+
+			size_t poolCount = std::count_if(m_componentPools.begin(), m_componentPools.end(),
+				[](const std::unique_ptr<ISparseSet>& pool) { return pool != nullptr; });
+			writer.Write<uint64_t>(poolCount);
+
+			for (size_t i = 0; i < m_componentPools.size(); i++) {
+				if (!m_componentPools[i]) continue;
+
+				writer.Write<uint64_t>(i);
+				m_componentPools[i]->Serialize(writer, delta ? m_snapshotEpochs[i] : 0);
+				m_snapshotEpochs[i] = m_componentPools[i]->AdvanceEpoch();
+			}
+
+			return snapshot;
+		}
+
+		/*
+		*  Hash() over any parallelFor(count, task), which has to call task(i) once for every
+		*  i < count and return once all of them finished. Stale blocks of every pool are
+		*  rehashed as one batch of tasks.
+		*/
+		template <typename ParallelFor>
+		uint64_t ComputeHash(ParallelFor parallelFor) {
+			std::vector<SparseSetBase*> pools;
+			for (const auto& pool : m_componentPools)
+				pools.push_back(static_cast<SparseSetBase*>(pool.get()));
+
+			std::vector<std::pair<SparseSetBase*, size_t>> stale;
+			for (SparseSetBase* pool : pools)
+				if (pool)
+					for (size_t block : pool->StaleHashBlocks())
+						stale.push_back({ pool, block });
+
+			parallelFor(stale.size(), [&stale](size_t i) {
+				stale[i].first->RehashBlock(stale[i].second);
+			});
+
+			// Pools are keyed by component name, their index depends on the order components were
+			// first used in. Empty pools are left out, registering one (e.g through View<T>())
+			// mustn't change the hash. Entity masks use those same indices, so only the entity
+			// count is hashed, which entities have what is already covered by the pools.
+			uint64_t hash = HashMix(m_entityMasks.Size());
+			for (size_t i = 0; i < pools.size(); i++) {
+				if (!pools[i]) continue;
+
+				uint64_t poolHash = pools[i]->FinishHash();
+				if (pools[i]->IsEmpty()) continue;
+
+				const std::string& name = m_componentNames[i];
+				hash += HashMix(poolHash ^ HashBytes(name.data(), name.size(), 0));
+			}
+			return hash;
+		}
+
+		// Folds the entity allocation state into a world hash, see Checksum()
+		uint64_t ChecksumFrom(uint64_t hash) {
+			FlushReservations();
+
+			// The free list is hashed in order, it decides the IDs handed out next
+			hash = HashMix(hash ^ m_maxEntityID);
+			return HashBytes(m_availableEntities.data(), m_availableEntities.size() * sizeof(EntityID), hash);
+		}
+
+	public:
+
+		/*
+		*  The entity lists and every component pool allocate from resource, e.g a WorldArena
+		*  or any std::pmr::memory_resource, which has to outlive the world. Pool objects,
+		*  names, indexes, resources and events still use the heap.
+		*/
+		explicit ECS(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+			m_resource{ resource }
+		{
+			auto index = std::make_unique<HashIndex<&EntityName::id>>();
+			m_entitiesByName = index.get();
+			m_entityNames.AddIndex(typeid(HashIndex<&EntityName::id>), std::move(index));
+		}
+
+		// Copies are forks, see Fork(), and allocate from the same resource
+		ECS(const ECS& other) :
+			ECS(other.m_resource)
+		{
+			RestoreFrom(other);
+		}
+
+		ECS& operator=(const ECS& other) {
+			RestoreFrom(other);
+			return *this;
+		}
+
+		template <typename T>
+		static void Define() {
+			static int index = 0;
+			return index;
+		}
+
+		/*
+		*  Deterministic mode, for lockstep simulations that must stay bit-identical across machines.
+		*  Worlds given the same sequence of operations then end up with the same IDs and layout:
+		*
+		*  - Freed IDs are recycled lowest first, regardless of the order they were freed in.
+		*  - CommandBuffer hands out provisional IDs, and creates the real entities in the order
+		*    they were recorded when committed. Commit buffers in a fixed order (e.g one per chunk
+		*    of work rather than one per thread).
+		*
+		*  ParallelReduce() in scheduler.h is deterministic in either mode, and Checksum() detects desyncs.
+		*/
+		void SetDeterministic(bool deterministic) {
+			m_deterministic = deterministic;
+			m_freeListSorted = false;
+		}
+
+		bool IsDeterministic() const {
+			return m_deterministic;
+		}
+
+		std::pmr::memory_resource* MemoryResource() const {
+			return m_resource;
+		}
+
+		void Reset() {
+			m_availableEntities.clear();
+			m_entityMasks.Clear();
+			m_entityNames.Clear();
+			m_nameIDs.clear();
+			m_nameTable.clear();
+			m_nameTableVersion = 0;
+			m_componentPools.clear();
+			m_resources.clear();
+			m_resourceData.clear();
+			m_eventChannels.clear();
+			m_snapshotEpochs.clear();
+			m_maxEntityID = 0;
+			m_recycleCursor = 0;
+			m_entityCapacity = MAX_ENTITIES;
+		}
+
+		/*
+		*  Returns an independent copy of the world: pools, masks, names, free list,
+		*  resources and snapshot state. Meant for speculative simulation and rollback:
+		*
+		*    ECS saved = ecs.Fork();
+		*    Simulate(ecs);            // Predict ahead
+		*    ecs.RestoreFrom(saved);   // Roll back when the prediction was wrong
+		*
+		*  Sparse pages and the pages of paged_storage pools are shared copy-on-write, so
+		*  a fork costs little more than the entity lists, and afterwards each world only
+		*  copies the pages it writes to. Other pools are copied, with memcpy when trivially
+		*  copyable. Resources must be copy constructible, and events copy assignable.
+		*/
+		ECS Fork() const {
+			return ECS(*this);
+		}
+
+		/*
+		*  Overwrites this world with a copy of other, typically a Fork() of it.
+		*  Pools and lists are assigned into the existing ones, so restoring a world
+		*  repeatedly allocates next to nothing once it has reached its peak size.
+		*  Must not run while other threads reserve IDs or run systems on either world.
+		*/
+		void RestoreFrom(const ECS& other) {
+			if (&other == this) return;
+
+			m_availableEntities = other.m_availableEntities;
+			m_deterministic = other.m_deterministic;
+			m_freeListSorted = other.m_freeListSorted;
+			m_entityCapacity = other.m_entityCapacity;
+			m_entityMasks.CopyFrom(other.m_entityMasks);
+
+			m_entityNames.CopyFrom(other.m_entityNames);
+			m_entitiesByName = static_cast<HashIndex<&EntityName::id>*>(
+				m_entityNames.GetIndex(typeid(HashIndex<&EntityName::id>)));
+
+			if (m_nameTableVersion != other.m_nameTableVersion) {
+				m_nameTable = other.m_nameTable;
+				m_nameIDs.clear();
+				for (size_t i = 0; i < m_nameTable.size(); i++)
+					m_nameIDs.emplace(m_nameTable[i], static_cast<uint32_t>(i));
+				m_nameTableVersion = other.m_nameTableVersion;
+			}
+
+			// Pools the other world doesn't have are emptied rather than freed, to be reused later
+			m_componentPools.resize(std::max(m_componentPools.size(), other.m_componentPools.size()));
+			for (size_t i = 0; i < m_componentPools.size(); i++) {
+				const ISparseSet* source = (i < other.m_componentPools.size()) ? other.m_componentPools[i].get() : nullptr;
+
+				if (!source) {
+					if (m_componentPools[i])
+						m_componentPools[i]->Clear();
+				}
+				else if (m_componentPools[i]) {
+					m_componentPools[i]->CopyFrom(*source);
+				}
+				else {
+					// Pools moved with SetPoolMemoryResource() stay on their resource, the rest move to this world's
+					std::pmr::memory_resource* resource = static_cast<const SparseSetBase*>(source)->MemoryResource();
+					m_componentPools[i] = source->Clone(resource == other.m_resource ? m_resource : resource);
+				}
+			}
+
+			// Pages now shared with other are copied right away, rather than on the next write
+			if (IsFixedCapacity()) {
+				m_availableEntities.reserve(m_entityCapacity);
+				m_entityMasks.Reserve(m_entityCapacity, m_entityCapacity);
+				for (auto& pool : m_componentPools)
+					if (pool)
+						pool->Reserve(std::min(pool->Capacity(), m_entityCapacity), m_entityCapacity);
+			}
+
+			// Resource indices are global, so existing slots hold the same type and are assigned into
+			m_resources.resize(other.m_resources.size());
+			m_resourceData.assign(other.m_resources.size(), nullptr);
+			for (size_t i = 0; i < m_resources.size(); i++) {
+				const IResourceSlot* source = other.m_resources[i].get();
+				if (!source)
+					m_resources[i] = nullptr;
+				else if (!m_resources[i] || !m_resources[i]->AssignFrom(*source))
+					m_resources[i] = source->Clone();
+
+				if (m_resources[i])
+					m_resourceData[i] = m_resources[i]->Data();
+			}
+
+			// Same as pools, events in flight are copied into the existing buffers
+			m_eventChannels.resize(std::max(m_eventChannels.size(), other.m_eventChannels.size()));
+			for (size_t i = 0; i < m_eventChannels.size(); i++) {
+				const IEventChannel* source = (i < other.m_eventChannels.size()) ? other.m_eventChannels[i].get() : nullptr;
+
+				if (!source) {
+					if (m_eventChannels[i])
+						m_eventChannels[i]->Clear();
+				}
+				else if (m_eventChannels[i]) {
+					m_eventChannels[i]->CopyFrom(*source);
+				}
+				else {
+					m_eventChannels[i] = source->Clone();
+				}
+			}
+
+			m_snapshotEpochs = other.m_snapshotEpochs;
+			m_maskSnapshotEpoch = other.m_maskSnapshotEpoch;
+			m_snapshotSequence = other.m_snapshotSequence;
+
+			m_maxEntityID = other.m_maxEntityID.load();
+			m_recycleCursor = other.m_recycleCursor.load();
+		}
+
+		/*
+		*  Hash of every component and the entity count. Independent of dense layout, since components
+		*  are hashed per entity and summed, and incremental: only the dense blocks written since
+		*  the last call are hashed again (see SparseSetBase::Hash()). Entity names aren't included,
+		*  and neither are empty pools, so worlds that merely registered different components agree.
+		*  Neither is the order components were first used in, pools are told apart by name.
+		*  See HashComponent() for how components are hashed, padding bytes must be initialized.
+		*
+		*  The ThreadPool overloads (defined in scheduler.h) rehash blocks in parallel,
+		*  with the same result.
+		*/
+		uint64_t Hash() {
+			return ComputeHash([](size_t count, const auto& task) {
+				for (size_t i = 0; i < count; i++)
+					task(i);
+			});
+		}
+
+		uint64_t Hash(ThreadPool& threads);
+
+		/*
+		*  Hash() plus the state deciding the IDs handed out next (free list, next fresh ID),
+		*  everything lockstep peers must agree on. Compare across machines to detect desyncs.
+		*/
+		uint64_t Checksum() {
+			return ChecksumFrom(Hash());
+		}
+
+		uint64_t Checksum(ThreadPool& threads);
+
+		/*
+		*  Serializes the whole world. This also becomes the base
+		*  the next TakeDeltaSnapshot() diffs against.
+		*/
+		Snapshot TakeSnapshot() {
+			return WriteSnapshot(false);
+		}
+
+		/*
+		*  Serializes only the dense blocks that changed since the last snapshot (full or delta),
+		*  along with the structural state (entity masks, free list) needed to apply them.
+		*/
+		Snapshot TakeDeltaSnapshot() {
+			SEECS_ASSERT(m_snapshotSequence > 0, "Delta snapshots need a full snapshot to diff against");
+			return WriteSnapshot(true);
+		}
+
+		/*
+		*  Overwrites this world with the contents of a snapshot.
+		*  Deltas must be applied in the order they were taken.
+		*/
+		void ApplySnapshot(const Snapshot& snapshot) {
+			if (snapshot.isDelta)
+				SEECS_ASSERT(snapshot.baseSequence == m_snapshotSequence,
+					"Delta snapshot " << snapshot.sequence << " applies onto snapshot " << snapshot.baseSequence
+					<< ", but the world is at snapshot " << m_snapshotSequence);
+
+			SnapshotReader reader{ snapshot.bytes };
+
+			m_maxEntityID = reader.Read<uint64_t>();
+			m_recycleCursor = 0;
+			m_availableEntities.resize(reader.Read<uint64_t>());
+			reader.ReadBytes(m_availableEntities.data(), m_availableEntities.size() * sizeof(EntityID));
+			m_freeListSorted = false;
+
+			m_entityMasks.Deserialize(reader);
+
+			std::vector<bool> applied(m_componentPools.size(), false);
+			size_t poolCount = reader.Read<uint64_t>();
+
+			for (size_t i = 0; i < poolCount; i++) {
+				size_t index = reader.Read<uint64_t>();
+				SEECS_ASSERT(index < m_poolFactories.size(), "Snapshot contains unknown component index " << index);
+
+				if (index >= m_componentPools.size()) {
+					m_componentPools.resize(index + 1);
+					applied.resize(index + 1, false);
+				}
+				if (!m_componentPools[index])
+					m_componentPools[index] = NewPool(index, m_resource);
+
+				m_componentPools[index]->Deserialize(reader);
+				applied[index] = true;
+			}
+
+			SEECS_ASSERT(reader.AtEnd(), "Trailing data in snapshot " << snapshot.sequence);
+
+			// Pools the snapshot doesn't know about were empty when it was taken
+			for (size_t i = 0; i < m_componentPools.size(); i++)
+				if (m_componentPools[i] && !applied[i])
+					m_componentPools[i]->Clear();
+
+			for (EntityID id : m_entityNames.GetEntityList())
+				if (!m_entityMasks.ContainsEntity(id))
+					m_entityNames.Delete(id);
+
+			m_snapshotSequence = snapshot.sequence;
+		}
+
+		/*
+		*  Records the structural calls made on this world into a trace, until StopRecording():
+		*  CreateEntity() (also through a CommandBuffer), Add(), Remove(), DeleteEntity(),
+		*  DeleteEntityAndChildren(), SetParent(), Clone() and Instantiate(). MarkFrame() separates frames.
+		*
+		*    seecs::Trace trace;
+		*    ecs.StartRecording(trace);
+		*    while (playing) {
+		*        ...
+		*        ecs.MarkFrame();
+		*    }
+		*    ecs.StopRecording();
+		*
+		*  ReplayTrace() plays it back, RunReplayBenchmark() in benchmark.h times it.
+		*  Components that aren't trivially copyable are replayed default constructed,
+		*  and writes through Get(), views or Patch() aren't recorded.
+		*  Record from an empty world, or replay onto a world restored to a snapshot taken when
+		*  recording started. Recording onto a non-empty trace appends to it.
+		*/
+		void StartRecording(Trace& trace) {
+			if (trace.bytes.empty()) {
+				SnapshotWriter writer{ trace.bytes };
+				writer.Write(Trace::MAGIC);
+				writer.Write(Trace::VERSION);
+			}
+
+			m_trace = &trace;
+			m_tracedComponents.clear();
+		}
+
+		void StopRecording() {
+			m_trace = nullptr;
+		}
+
+		bool IsRecording() const {
+			return m_trace != nullptr;
+		}
+
+		// Marks the end of a frame in the trace being recorded, does nothing otherwise
+		void MarkFrame() {
+			if (m_trace)
+				Record(Trace::Op::Frame, {});
+		}
+
+		/*
+		*  Replays a trace recorded by StartRecording(), calling onFrame() at every frame mark.
+		*  Components are matched by type name, so every component in the trace must have been
+		*  used or registered by this program first (see RegisterComponents()).
+		*  Entities created by the trace are mapped to the IDs this world hands out, others keep
+		*  their recorded ID. Returns the number of operations replayed.
+		*/
+		template <typename Func>
+		size_t ReplayTrace(const Trace& trace, Func onFrame) {
+			SnapshotReader reader{ trace.bytes };
+			SEECS_ASSERT(reader.Read<uint32_t>() == Trace::MAGIC, "Not a trace");
+			SEECS_ASSERT(reader.Read<uint32_t>() == Trace::VERSION, "Trace was recorded by an incompatible version");
+
+			// Recorded component indices and entity IDs to ours
+			std::vector<size_t> components;
+			std::vector<EntityID> entities;
+
+			auto component = [&](uint64_t recorded) {
+				SEECS_ASSERT(recorded < components.size() && components[recorded] < MAX_COMPONENTS,
+					"Trace uses component " << recorded << " before describing it");
+				return components[recorded];
+			};
+			auto entity = [&](uint64_t recorded) -> EntityID {
+				if (recorded < entities.size() && entities[recorded] != NULL_ENTITY)
+					return entities[recorded];
+				return recorded;
+			};
+
+			// Reused between operations, so replaying doesn't allocate once they've grown
+			std::string name;
+			std::vector<uint8_t> bytes;
+			size_t operations = 0;
+
+			while (!reader.AtEnd()) {
+				switch (reader.Read<Trace::Op>()) {
+				case Trace::Op::Component: {
+					size_t recorded = reader.ReadVarint();
+					size_t size = reader.ReadVarint();
+					name.resize(reader.ReadVarint());
+					reader.ReadBytes(name.data(), name.size());
+
+					auto it = std::find(m_componentNames.begin(), m_componentNames.end(), name);
+					SEECS_ASSERT(it != m_componentNames.end(),
+						"Trace uses component '" << name << "', which this program hasn't registered");
+
+					size_t index = it - m_componentNames.begin();
+					if (index >= m_componentPools.size())
+						m_componentPools.resize(index + 1);
+					if (!m_componentPools[index])
+						m_componentPools[index] = NewPool(index, m_resource);
+
+					SEECS_ASSERT(m_componentPools[index]->TracedSize() == size,
+						"Component '" << name << "' changed size since the trace was recorded");
+
+					if (recorded >= components.size())
+						components.resize(recorded + 1, MAX_COMPONENTS);
+					components[recorded] = index;
+					continue;
+				}
+				case Trace::Op::Create: {
+					EntityID recorded = reader.ReadVarint();
+					name.resize(reader.ReadVarint());
+					reader.ReadBytes(name.data(), name.size());
+
+					if (recorded >= entities.size())
+						entities.resize(recorded + 1, NULL_ENTITY);
+					entities[recorded] = CreateEntity(name);
+					break;
+				}
+				case Trace::Op::Add: {
+					size_t index = component(reader.ReadVarint());
+					EntityID id = entity(reader.ReadVarint());
+					SEECS_ASSERT_VALID_ENTITY(id);
+					SEECS_ASSERT_ALIVE_ENTITY(id);
+
+					ISparseSet& pool = *m_componentPools[index];
+					bytes.resize(pool.TracedSize());
+					reader.ReadBytes(bytes.data(), bytes.size());
+
+					GetEntityMask(id)[index] = 1;
+					pool.SetTraced(id, bytes.empty() ? nullptr : bytes.data());
+					if (m_trace)
+						RecordComponent(Trace::Op::Add, index, id, bytes.data());
+					break;
+				}
+				case Trace::Op::Remove: {
+					size_t index = component(reader.ReadVarint());
+					EntityID id = entity(reader.ReadVarint());
+					SEECS_ASSERT_VALID_ENTITY(id);
+					SEECS_ASSERT_ALIVE_ENTITY(id);
+
+					if (!m_componentPools[index]->ContainsEntity(id))
+						break;
+
+					GetEntityMask(id)[index] = 0;
+					m_componentPools[index]->Delete(id);
+					if (m_trace)
+						RecordComponent(Trace::Op::Remove, index, id);
+					break;
+				}
+				case Trace::Op::Delete: {
+					EntityID id = entity(reader.ReadVarint());
+					DeleteEntity(id);
+					break;
+				}
+				case Trace::Op::DeleteTree: {
+					EntityID id = entity(reader.ReadVarint());
+					DeleteEntityAndChildren(id);
+					break;
+				}
+				case Trace::Op::SetParent: {
+					EntityID child = entity(reader.ReadVarint());
+					EntityID parent = reader.ReadVarint() - 1;
+					SetParent(child, parent == NULL_ENTITY ? NULL_ENTITY : entity(parent));
+					break;
+				}
+				case Trace::Op::Clone: {
+					EntityID source = entity(reader.ReadVarint());
+					size_t count = reader.ReadVarint();
+
+					for (EntityID id : Clone(source, count)) {
+						EntityID recorded = reader.ReadVarint();
+						if (recorded >= entities.size())
+							entities.resize(recorded + 1, NULL_ENTITY);
+						entities[recorded] = id;
+					}
+					break;
+				}
+				case Trace::Op::Frame:
+					MarkFrame();
+					onFrame();
+					continue;
+				default:
+					SEECS_ASSERT(false, "Unknown operation in trace, data is truncated or corrupt");
+				}
+
+				operations++;
+			}
+
+			return operations;
+		}
+
+		/*
+		*  Creates an entity and returns the ID to refer to that entity.
+		*
+		*  @param(name):
+		*  * Optional and used for debugging purposes. Names are interned,
+		*    so entities sharing a name share a single copy of it.
+		*/
+		EntityID CreateEntity(std::string_view name = "") {
+			FlushReservations();
+
+			EntityID id = NULL_ENTITY;
+
+			// Either spawn a new ID or recycle one
+			if (m_availableEntities.size() == 0) {
+				SEECS_ASSERT(m_maxEntityID < m_entityCapacity, "Entity limit exceeded");
+				id = m_maxEntityID++;
+			}
+			else {
+				id = m_availableEntities.back();
+				m_availableEntities.pop_back();
+			}
+
+			MaterializeEntity(id, name);
+			return id;
 		}
 
 		/*
-		*  Executes a passed lambda on all the entities that match the
-		*  passed parameter pack.
-		*
-		*  Provided function should follow one of two forms:
-		*  [](Component& c1, Component& c2);
-		*  OR
-		*  [](EntityID id, Component& c1, Component& c2);
+		*  CreateEntity() reporting exhaustion instead of asserting, writes the new ID to id.
+		*  Doesn't allocate in fixed capacity worlds, see SetEntityCapacity().
 		*/
-		void ForEach(ForEachFunc func) {
-			ForEachImpl(func);
+		Result TryCreateEntity(EntityID& id) {
+			FlushReservations();
+
+			if (m_availableEntities.empty() && m_maxEntityID >= m_entityCapacity)
+				return Result::EntityLimit;
+
+			id = CreateEntity();
+			return Result::Ok;
 		}
 
-		void ForEach(ForEachFuncWithID func) {
-			ForEachImpl(func);
+		// Valid for as long as the ECS isn't Reset()
+		std::string_view GetEntityName(EntityID id) {
+			SEECS_ASSERT_VALID_ENTITY(id);
+			SEECS_ASSERT_ALIVE_ENTITY(id);
+
+			const EntityName* name = std::as_const(m_entityNames).Get(id);
+			if (name)
+				return m_nameTable[name->id];
+
+			return "Entity";
 		}
 
 		/*
-		*	Holds an entity id and a tuple of references to the components returned by the view.
-		*	Access components that are part of a pack like such:
-		*	- auto [componentA, componentB] = pack.components;
+		*  Returns an entity created with the given name, or NULL_ENTITY if there's none.
+		*  O(1), FindEntities() returns all of them.
 		*/
-		struct Pack {
-			EntityID id;
-			std::tuple<Components&...> components;
-		};
+		EntityID FindEntity(std::string_view name) {
+			Span<const EntityID> entities = FindEntities(name);
+			return entities.empty() ? NULL_ENTITY : entities[0];
+		}
+
+		// Invalidated by creating or deleting entities
+		Span<const EntityID> FindEntities(std::string_view name) {
+			auto it = m_nameIDs.find(name);
+			if (it == m_nameIDs.end())
+				return { nullptr, 0 };
+			return m_entitiesByName->Find(it->second);
+		}
 
 		/*
-		*  Useful when you want a way to iterate a view via indices.
-		*  e.g:
-			auto packed = ecs.View<A, B>().GetPacked();
-			for (size_t i = 0; i < packed.size(); i++) {
-				auto [a1, b1] = packed[i].components;
-			}
+		* Deletes an active entity and its associated components.
+		* - Overwrites the given entity to NULL_ENTITY.
+		*
 		*/
-		std::vector<Pack> GetPacked() {
-			constexpr auto inds = std::make_index_sequence<sizeof...(Components)>{};
-			std::vector<Pack> result;
-
-			for (EntityID id : m_smallest->GetEntityList())
-				if (AllContain(id))
-					result.push_back({ id, MakeComponentTuple(id, inds) });
-			return result;
-		}
+		void DeleteEntity(EntityID& id) {
+			SEECS_ASSERT_VALID_ENTITY(id);
+			SEECS_ASSERT_ALIVE_ENTITY(id);
 
+			FlushReservations();
 
-	};
+			if (m_trace)
+				Record(Trace::Op::Delete, { id });
+			RecordingPause pause{ *this };
 
+			// Children outlive their parent as roots, see DeleteEntityAndChildren()
+			if (Has<Hierarchy>(id)) {
+				Unlink(id);
+				while (GetComponentPool<Hierarchy>().GetRef(id).firstChild != NULL_ENTITY)
+					SetParent(GetComponentPool<Hierarchy>().GetRef(id).firstChild, NULL_ENTITY);
+			}
 
+			DestroyEntity(id);
+		}
 
-	class ECS {
-	private:
+		/*
+		*  Deletes an entity along with all of its descendants.
+		*  - Overwrites the given entity to NULL_ENTITY.
+		*/
+		void DeleteEntityAndChildren(EntityID& id) {
+			SEECS_ASSERT_VALID_ENTITY(id);
+			SEECS_ASSERT_ALIVE_ENTITY(id);
 
-		// Each bit in the mask represents a component,
-		// '1' == active, '0' == inactive.
-		using ComponentMask = std::bitset<MAX_COMPONENTS>;
+			FlushReservations();
 
+			if (m_trace)
+				Record(Trace::Op::DeleteTree, { id });
+			RecordingPause pause{ *this };
 
-		// List of IDs already created, but no longer in use
-		std::vector<EntityID> m_availableEntities;
+			if (!Has<Hierarchy>(id)) {
+				DestroyEntity(id);
+				return;
+			}
 
+			// The links inside the subtree die with it, only the root has to be unlinked
+			std::vector<EntityID> subtree = GetDescendants(id);
+			Unlink(id);
 
-		// Holds the component mask for an entity
-		SparseSet<ComponentMask> m_entityMasks;
+			for (EntityID& child : subtree)
+				DestroyEntity(child);
+			DestroyEntity(id);
+		}
 
+		/*
+		*  Register a component and create a pool for it
+		*/
+		template <typename T>
+		void RegisterComponent() {
+			SEECS_ASSERT(m_componentPools.size() <= MAX_COMPONENTS,
+				"Exceeded max number of registered components");
 
-		// Associates ID with name provided in CreateEntity(), mainly for debugging
-		SparseSet<std::string> m_entityNames;
+			size_t ind = GetComponentIndex<T>();
+			if (ind >= m_componentPools.size())
+				m_componentPools.resize(ind + 1);
 
+			SEECS_ASSERT(!m_componentPools[ind],
+				"Attempting to register component '" << typeid(T).name() << "' twice");
 
-		// Holds generic pointers to specific component sparse sets.
-		// 
-		// Index into this array using the corresponding bit position
-		// found by using m_componentBitPosition
-		std::vector<std::unique_ptr<ISparseSet>> m_componentPools;
+			m_componentPools[ind] = NewPool(ind, m_resource);
 
+			SEECS_INFO("Registered component '" << typeid(T).name() << "'");
+		}
 
-		// Helpful little vector that associates component index with a name
-		// Just for debugging.
-		inline static std::vector<std::string> m_componentNames;
+		/*
+		*  Registers any of the given components that don't have a pool yet.
+		*  Pools are otherwise created on first use, which isn't thread safe.
+		*/
+		template <typename... Ts>
+		void RegisterComponents() {
+			(GetOrRegisterComponentIndex<Ts>(), ...);
+		}
 
+		/*
+		*  Turns this into a fixed capacity world, for real-time threads that can't allocate after
+		*  setup. Storage for the given number of entities is preallocated in the entity lists and
+		*  every pool (SetPoolCapacity() overrides it per pool), and IDs are never handed out past it:
+		*
+		*    ecs.SetEntityCapacity(4096);
+		*    ecs.SetPoolCapacity<Voice>(256);
+		*    ecs.RegisterComponents<Envelope, Filter>();   // Pools created later preallocate when created
+		*
+		*    EntityID voice;
+		*    if (ecs.TryCreateEntity(voice) == seecs::Result::Ok)
+		*        ecs.TryAdd<Voice>(voice, { ... });
+		*
+		*  From then on unnamed CreateEntity(), Add(), Get(), Remove(), DeleteEntity() of entities
+		*  without children and their Try* variants don't allocate, nor do ForEachChunk() and
+		*  ForEachInRange() of views (ForEach() iterates a copy of the entity list). At capacity
+		*  the Try* functions return an error code while the others assert. Clone(), Instantiate()
+		*  and their Try* variants respect the capacities but allocate the ID list they return.
+		*  Names, hierarchies, sorting, secondary indexes, command buffers, events, snapshots and
+		*  traces still allocate.
+		*  Must be called before any entity past the capacity exists, lasts until Reset().
+		*  Forks and worlds restored from this one get the same capacities.
+		*/
+		void SetEntityCapacity(size_t entities) {
+			SEECS_ASSERT(m_maxEntityID <= entities, "World already has entities past a capacity of " << entities);
+			m_entityCapacity = entities;
+
+			m_availableEntities.reserve(entities);
+			m_entityMasks.Reserve(entities, entities);
+			for (auto& pool : m_componentPools)
+				if (pool)
+					pool->Reserve(entities, entities);
+
+			// DeleteEntity() checks for children, which registers the type the first time
+			GetComponentIndex<Hierarchy>();
+		}
 
-		// Highest recorded entity ID
-		EntityID m_maxEntityID = 0;
+		/*
+		*  Preallocates count components of T and caps the pool there, TryAdd() reports it full
+		*  past that. Only in fixed capacity worlds, see SetEntityCapacity().
+		*/
+		template <typename T>
+		void SetPoolCapacity(size_t count) {
+			SEECS_ASSERT(IsFixedCapacity(), "SetPoolCapacity() needs SetEntityCapacity() first");
 
+			size_t index = GetComponentIndex<T>();
+			if (index >= m_componentPools.size())
+				m_componentPools.resize(index + 1);
 
-#define ENTITY_INFO(id) \
-			"['" << GetEntityName(id) << "', ID: " << id << "]"
+			// Created right at its capacity, rather than with room for every entity first
+			if (!m_componentPools[index])
+				m_componentPools[index] = m_poolFactories[index](m_resource);
 
-#define SEECS_ASSERT_VALID_ENTITY(id) \
-			SEECS_ASSERT(id != NULL_ENTITY, "NULL_ENTITY cannot be operated on by the ECS") \
-			SEECS_ASSERT(id < m_maxEntityID && id >= 0, "Invalid entity ID out of bounds: " << id);
+			ISparseSet& pool = *m_componentPools[index];
+			SEECS_ASSERT(pool.Size() <= count, "Pool of '" << typeid(T).name() << "' already holds more than " << count);
+			pool.Reserve(count, m_entityCapacity);
+		}
 
-#define SEECS_ASSERT_ALIVE_ENTITY(id) \
-			SEECS_ASSERT(m_entityMasks.Get(id) != nullptr, "Attempting to access inactive entity with ID: " << id);
+		bool IsFixedCapacity() const {
+			return m_entityCapacity != MAX_ENTITIES;
+		}
 
-	private:
+		size_t EntityCapacity() const {
+			return m_entityCapacity;
+		}
 
-		static size_t GetNextComponentIndex(std::string typeName) {
-			static size_t ind = 0;
-			m_componentNames.push_back(typeName);
-			return ind++;
-		};
+		/*
+		*  Moves the pool of a component to another memory resource, e.g a HugePageResource bound
+		*  to the NUMA node of the threads working on it. The components are copied over, so do it
+		*  during setup. The pool object stays the same, so views and accessors remain valid, but
+		*  references and spans to components don't. Lasts until Reset().
+		*/
+		template <typename T>
+		void SetPoolMemoryResource(std::pmr::memory_resource* resource) {
+			ComponentPool<T>& pool = GetComponentPool<T>();
 
-		// Returns a unique ID for each type, used to index component pools
-		// - Since it's static, all ECS instances share the same index for each component type.
-        template <typename T>
-        static size_t GetComponentIndex() {
-			static size_t ind = GetNextComponentIndex(typeid(T).name());
-            return ind;
-        };
+			size_t capacity = pool.Capacity();
+			pool.MoveToResource(resource);
+			if (IsFixedCapacity())
+				pool.Reserve(capacity, m_entityCapacity);
+		}
 
-		// Same as GetComponentTypeIndex, but will register if the component doesn't exist yet.
+		/*
+		*  Attaches a component to an entity
+		*
+		* - Add<Transform>(player, {x, y, z});
+		* 
+		*  Returns a reference to the stored component, except for SoA
+		*  components which have no T in memory to refer to.
+		*/
 		template <typename T>
-		size_t GetOrRegisterComponentIndex() {
-			size_t index = GetComponentIndex<T>();
+		decltype(auto) Add(EntityID id, T&& component = {}) {
+			SEECS_ASSERT_VALID_ENTITY(id);
+			SEECS_ASSERT_ALIVE_ENTITY(id);
 
-			if (index >= m_componentPools.size() || !m_componentPools[index])
-				RegisterComponent<T>();
+			ComponentPool<T>& pool = GetComponentPool<T>();
 
-			// Internal error, should never happen outside development
-			SEECS_ASSERT(index < m_componentPools.size() && index >= 0,
-				"Type index out of bounds for component '" << typeid(T).name() << "'");
+			// If component isn't attached yet, flag it in the mask
+			if (!pool.ContainsEntity(id)) {
+				SEECS_ASSERT(pool.Size() < pool.Capacity(), "Pool of '" << typeid(T).name() << "' is full");
+				ComponentMask& mask = GetEntityMask(id);
+				SetComponentBit<T>(mask, 1);
+				SEECS_INFO("Attached '" << typeid(T).name() << "' to " << ENTITY_INFO(id));
+			}
 
-			return index;
+			if constexpr (is_soa_v<T>) {
+				pool.Set(id, component);
+				if (m_trace)
+					RecordComponent(Trace::Op::Add, GetComponentIndex<T>(), id, &component);
+			}
+			else {
+				T& stored = *pool.Set(id, std::move(component));
+				if (m_trace)
+					RecordComponent(Trace::Op::Add, GetComponentIndex<T>(), id, &stored);
+				return stored;
+			}
 		}
 
 		/*
-		*   Retrieves an uncasted pointer to a pool of type T
+		*  Add() reporting a full pool instead of asserting, overwriting an
+		*  existing component always succeeds. See SetPoolCapacity().
 		*/
 		template <typename T>
-		ISparseSet* GetComponentPoolPtr() {
-			size_t index = GetOrRegisterComponentIndex<T>();
-			return m_componentPools[index].get();
+		Result TryAdd(EntityID id, T&& component = {}) {
+			ComponentPool<T>& pool = GetComponentPool<T>();
+			if (pool.Size() >= pool.Capacity() && !pool.ContainsEntity(id))
+				return Result::PoolFull;
+
+			Add<T>(id, std::move(component));
+			return Result::Ok;
 		}
 
 		/*
-		* Retrieves reference for the specific component pool given a component name
+		*  Retrieves the specified component for the given entity
+		*
+		* - ecs.Get<Transform>(player);
 		*/
 		template <typename T>
-		SparseSet<T>& GetComponentPool() {
-			ISparseSet* genericPtr = GetComponentPoolPtr<T>();
-			SparseSet<T>* pool = static_cast<SparseSet<T>*>(genericPtr);
+		T& Get(EntityID id) {
+			static_assert(!is_soa_v<T>, "SoA components can't be referenced, use GetField() or Load()");
+			SEECS_ASSERT_VALID_ENTITY(id);
+			SEECS_ASSERT_ALIVE_ENTITY(id);
 
-			return *pool;
-		}
+			// Get<const T> goes through the pool's read-only path
+			using Pool = std::conditional_t<std::is_const_v<T>,
+				const SparseSet<std::remove_const_t<T>>, SparseSet<T>>;
 
-		template <typename Component>
-		void SetComponentBit(ComponentMask& mask, bool val) {
-			size_t bitPos = GetComponentIndex<Component>();
-			mask[bitPos] = val;
-		}
+			Pool& pool = GetComponentPool<std::remove_const_t<T>>();
+			T* component = pool.Get(id);
+			SEECS_ASSERT(component,
+				ENTITY_INFO(id) << " missing component in '" << typeid(T).name() << "' pool");
 
-		template <typename Component>
-		ComponentMask::reference GetComponentBit(ComponentMask& mask) {
-			size_t bitPos = GetComponentIndex<Component>();
-			return mask[bitPos];
+			return *component;
 		}
 
-		ComponentMask& GetEntityMask(EntityID id) {
-			ComponentMask* mask = m_entityMasks.Get(id);
-			SEECS_ASSERT(mask, "Entity " << ENTITY_INFO(id) << " has no component mask");
-			return *mask;
+		/*
+		*  Retrieves a pointer to the specified component for the given entity
+		*
+		* - ecs.GetPtr<Transform>(player);
+		*/
+		template <typename T>
+		T* GetPtr(EntityID id) {
+			static_assert(!is_soa_v<T>, "SoA components can't be referenced, use GetField() or Load()");
+			SEECS_ASSERT_VALID_ENTITY(id);
+			SEECS_ASSERT_ALIVE_ENTITY(id);
+
+			SparseSet<T>& pool = GetComponentPool<T>();
+			return pool.Get(id);
 		}
 
 		/*
-		*  Assembles a generic mask for the given components
+		*  Removes a component from an entity
+		*
+		* - ecs.Remove<Transform>(player);
 		*/
-		template <typename... Components>
-		ComponentMask GetMask() {
-			ComponentMask mask;
-			(SetComponentBit<Components>(mask, 1), ...);
-			return mask;
+		template <typename T>
+		void Remove(EntityID id) {
+			SEECS_ASSERT_VALID_ENTITY(id);
+			SEECS_ASSERT_ALIVE_ENTITY(id);
+
+			ComponentPool<T>& pool = GetComponentPool<T>();
+
+			if (!pool.ContainsEntity(id)) return;
+
+			ComponentMask& mask = GetEntityMask(id);
+			SetComponentBit<T>(mask, 0);
+
+			pool.Delete(id);
+			if (m_trace)
+				RecordComponent(Trace::Op::Remove, GetComponentIndex<T>(), id);
+
+			SEECS_INFO("Removed '" << typeid(T).name() << "' from " << ENTITY_INFO(id));
 		}
 
-	public:
+		/*
+		*  Retrieves a single field of an SoA component for the given entity
+		*
+		* - ecs.GetField<&Position::x>(player) += 1.0f;
+		*/
+		template <auto Member>
+		auto& GetField(EntityID id) {
+			using T = typename member_traits<decltype(Member)>::class_type;
+			SEECS_ASSERT_VALID_ENTITY(id);
+			SEECS_ASSERT_ALIVE_ENTITY(id);
 
-		ECS() = default;
+			auto* field = GetComponentPool<T>().template GetField<Member>(id);
+			SEECS_ASSERT(field,
+				ENTITY_INFO(id) << " missing component in '" << typeid(T).name() << "' pool");
 
-		template <typename T>
-		static void Define() {
-			static int index = 0;
-			return index;
+			return *field;
 		}
 
-		void Reset() {
-			m_availableEntities.clear();
-			m_entityMasks.Clear();
-			m_entityNames.Clear();
-			m_componentPools.clear();
-			m_maxEntityID = 0;
+		/*
+		*  Assembles a copy of an SoA component for the given entity
+		*/
+		template <typename T>
+		T Load(EntityID id) {
+			static_assert(is_soa_v<T>, "Load() is only needed for SoA components, use Get()");
+			SEECS_ASSERT_VALID_ENTITY(id);
+			SEECS_ASSERT_ALIVE_ENTITY(id);
+
+			return GetComponentPool<T>().Load(id);
 		}
 
 		/*
-		*  Creates an entity and returns the ID to refer to that entity.
+		*  Retrieves the column store of an SoA component, for iterating fields as spans:
 		*
-		*  @param(name):
-		*  * Optional and used for debugging purposes, it
-		*    shouldn't be used often since there's no optimization
-		*    in place yet for entities that share a name.
+		*    auto& positions = ecs.Columns<Position>();
+		*    for (float& x : positions.Column<&Position::x>()) { ... }
 		*/
-		EntityID CreateEntity(std::string name = "") {
-			EntityID id = NULL_ENTITY;
+		template <typename T>
+		SoASparseSet<T>& Columns() {
+			static_assert(is_soa_v<T>, "Component has no soa_fields specialization");
+			return GetComponentPool<T>();
+		}
 
-			// Either spawn a new ID or recycle one
-			if (m_availableEntities.size() == 0) {
-				SEECS_ASSERT(m_maxEntityID < MAX_ENTITIES, "Entity limit exceeded");
-				id = m_maxEntityID++;
-			}
-			else {
-				id = m_availableEntities.back();
-				m_availableEntities.pop_back();
-			}
+		/*
+		*  Makes parent the parent of child, or detaches child when parent is NULL_ENTITY.
+		*  Both get a Hierarchy component if they don't have one yet.
+		*/
+		void SetParent(EntityID child, EntityID parent) {
+			SEECS_ASSERT_VALID_ENTITY(child);
+			SEECS_ASSERT_ALIVE_ENTITY(child);
+
+			if (m_trace)
+				Record(Trace::Op::SetParent, { child, parent + 1 });
+			RecordingPause pause{ *this };
+
+			ComponentPool<Hierarchy>& pool = GetHierarchyPool();
+			if (!Has<Hierarchy>(child))
+				Add<Hierarchy>(child);
 
-			SEECS_ASSERT(id != NULL_ENTITY, "Cannot create entity with null ID");
+			Unlink(child);
 
-			m_entityMasks.Set(id, {});
+			uint32_t depth = 0;
+			if (parent != NULL_ENTITY) {
+				SEECS_ASSERT_ALIVE_ENTITY(parent);
+				if (!Has<Hierarchy>(parent))
+					Add<Hierarchy>(parent);
 
-			if (!name.empty())
-				m_entityNames.Set(id, name);
+				for (EntityID ancestor = parent; ancestor != NULL_ENTITY; ancestor = pool.GetRef(ancestor).parent)
+					SEECS_ASSERT(ancestor != child, "Parenting " << ENTITY_INFO(child) << " to " << ENTITY_INFO(parent) << " creates a cycle");
 
-			SEECS_INFO("Created entity " << ENTITY_INFO(id));
-			return id;
+				Hierarchy& parentNode = pool.GetRef(parent);
+				EntityID oldFirst = parentNode.firstChild;
+				parentNode.firstChild = child;
+				parentNode.childCount++;
+				depth = parentNode.depth + 1;
+
+				if (oldFirst != NULL_ENTITY)
+					pool.GetRef(oldFirst).prevSibling = child;
+
+				Hierarchy& node = pool.GetRef(child);
+				node.parent = parent;
+				node.nextSibling = oldFirst;
+			}
+
+			SetDepth(child, depth);
 		}
 
-		std::string GetEntityName(EntityID id) {
+		EntityID GetParent(EntityID id) {
 			SEECS_ASSERT_VALID_ENTITY(id);
 			SEECS_ASSERT_ALIVE_ENTITY(id);
 
-			auto name = m_entityNames.Get(id);
-			if (name)
-				return *name;
-
-			return "Entity";
+			const Hierarchy* node = std::as_const(GetHierarchyPool()).Get(id);
+			return node ? node->parent : NULL_ENTITY;
 		}
 
 		/*
-		* Deletes an active entity and its associated components.
-		* - Overwrites the given entity to NULL_ENTITY.
-		*
+		*  Calls func(EntityID) for each direct child of an entity.
+		*  Don't reparent or delete children from inside func.
 		*/
-		void DeleteEntity(EntityID& id) {
-			SEECS_ASSERT_VALID_ENTITY(id);
-			SEECS_ASSERT_ALIVE_ENTITY(id);
+		template <typename Func>
+		void ForEachChild(EntityID id, Func func) {
+			const ComponentPool<Hierarchy>& pool = GetHierarchyPool();
+			const Hierarchy* node = pool.Get(id);
+			if (!node) return;
 
-			std::string name = GetEntityName(id);
-			ComponentMask& mask = GetEntityMask(id);
+			for (EntityID child = node->firstChild; child != NULL_ENTITY; child = pool.GetRef(child).nextSibling)
+				func(child);
+		}
 
-			// Destroy component associations
-			for (int i = 0; i < MAX_COMPONENTS; i++)
-				if (mask[i] == 1)
-					m_componentPools[i]->Delete(id);
+		// Every descendant of an entity, each parent listed before its children
+		std::vector<EntityID> GetDescendants(EntityID id) {
+			const ComponentPool<Hierarchy>& pool = GetHierarchyPool();
+			std::vector<EntityID> descendants;
 
-			m_entityMasks.Delete(id);
-			m_entityNames.Delete(id);
-			m_availableEntities.push_back(id);
+			if (pool.Get(id))
+				AppendChildren(pool, id, descendants);
+			for (size_t i = 0; i < descendants.size(); i++)
+				AppendChildren(pool, descendants[i], descendants);
 
-			SEECS_INFO("Deleted entity ['" << name << "', ID: " << id << "]");
-			id = NULL_ENTITY;
+			return descendants;
 		}
 
 		/*
-		*  Register a component and create a pool for it
+		*  Every entity with a Hierarchy component ordered by depth, so each parent comes
+		*  before its children. Propagating transforms is then a single pass:
+		*
+		*    for (EntityID id : ecs.HierarchyOrder()) {
+		*        EntityID parent = ecs.GetParent(id);
+		*        if (parent != NULL_ENTITY)
+		*            ecs.Get<World>(id) = ecs.Get<World>(parent) * ecs.Get<Local>(id);
+		*    }
+		*
+		*  Sorting other pools with SortAs<T, Hierarchy>() makes that pass linear in memory too.
+		*  The span is invalidated by anything changing the hierarchy.
+		*/
+		Span<const EntityID> HierarchyOrder() {
+			ComponentPool<Hierarchy>& pool = GetHierarchyPool();
+			pool.Resort();
+			return pool.Entities();
+		}
+
+		/*
+		*  Sorts the pool of T in place, see SparseSet::Sort(). SoA pools can only be sorted by EntityID.
+		*
+		*    ecs.Sort<Sprite>([](const Sprite& a, const Sprite& b) { return a.material < b.material; });
+		*/
+		template <typename T, typename Compare>
+		void Sort(Compare cmp) {
+			if constexpr (is_soa_v<T>) {
+				static_assert(std::is_invocable_r_v<bool, Compare&, EntityID, EntityID>,
+					"SoA components can only be sorted with an EntityID comparator");
+				GetComponentPool<T>().SortByEntity(cmp);
+			}
+			else {
+				GetComponentPool<T>().Sort(cmp);
+			}
+		}
+
+		/*
+		*  Orders the pool of T like the pool of U, so iterating both hits memory sequentially.
+		*  Entities with both components come first, returns how many there are.
+		*/
+		template <typename T, typename U>
+		size_t SortAs() {
+			return GetComponentPool<T>().SortAs(GetComponentPool<U>());
+		}
+
+		/*
+		*  Keeps the pool of T sorted by cmp, repaired incrementally by Resort<T>().
+		*  See SparseSet::KeepSorted().
 		*/
+		template <typename T, typename Compare>
+		void KeepSorted(Compare cmp) {
+			static_assert(!is_soa_v<T>, "SoA components can't be kept sorted");
+			GetComponentPool<T>().KeepSorted(cmp);
+		}
+
 		template <typename T>
-		void RegisterComponent() {
-			SEECS_ASSERT(m_componentPools.size() <= MAX_COMPONENTS,
-				"Exceeded max number of registered components");
+		void Resort() {
+			static_assert(!is_soa_v<T>, "SoA components can't be kept sorted");
+			GetComponentPool<T>().Resort();
+		}
 
-			size_t ind = GetComponentIndex<T>();
-			if (ind >= m_componentPools.size())
-				m_componentPools.resize(ind + 1);
+		/*
+		*  Creates count copies of an entity, components included, and returns their IDs.
+		*  Each pool is grown once and filled in bulk, which is much cheaper than
+		*  creating the entities and adding their components one by one.
+		*  Clones are unnamed, and start out without a Hierarchy (they aren't parented).
+		*/
+		std::vector<EntityID> Clone(EntityID source, size_t count = 1) {
+			SEECS_ASSERT_VALID_ENTITY(source);
+			SEECS_ASSERT_ALIVE_ENTITY(source);
+
+			ComponentMask mask = GetEntityMask(source);
+			mask.reset(GetComponentIndex<Hierarchy>());
+			SEECS_ASSERT(CheckRoom(count, mask) != Result::PoolFull, "Pool capacity exceeded cloning " << ENTITY_INFO(source));
+
+			std::vector<EntityID> ids = AllocateEntities(count, mask);
+			for (size_t i = 0; i < m_componentPools.size(); i++)
+				if (mask[i])
+					m_componentPools[i]->CloneComponent(source, ids.data(), count);
+
+			if (m_trace) {
+				Record(Trace::Op::Clone, { source, count });
+				for (EntityID id : ids)
+					SnapshotWriter{ m_trace->bytes }.WriteVarint(id);
+			}
 
-			SEECS_ASSERT(!m_componentPools[ind],
-				"Attempting to register component '" << typeid(T).name() << "' twice");
+			return ids;
+		}
 
-			m_componentPools[ind] = std::make_unique<SparseSet<T>>();
+		/*
+		*  Clone() reporting exhaustion instead of asserting, writes the new IDs to ids.
+		*  Nothing is created unless every clone fits. See SetEntityCapacity().
+		*/
+		Result TryClone(EntityID source, std::vector<EntityID>& ids, size_t count = 1) {
+			ComponentMask mask = GetEntityMask(source);
+			mask.reset(GetComponentIndex<Hierarchy>());
 
-			SEECS_INFO("Registered component '" << typeid(T).name() << "'");
+			Result result = CheckRoom(count, mask);
+			if (result == Result::Ok)
+				ids = Clone(source, count);
+			return result;
 		}
 
+		// Creates count entities from a Prefab, see Prefab
+		std::vector<EntityID> Instantiate(const Prefab& prefab, size_t count = 1);
+
+		// Instantiate() reporting exhaustion instead of asserting, see TryClone()
+		Result TryInstantiate(const Prefab& prefab, std::vector<EntityID>& ids, size_t count = 1);
+
 		/*
-		*  Attaches a component to an entity
+		*  Stores a resource, a singleton that isn't attached to any entity (Time, Input, ...).
+		*  Replaces the previous value if there is one.
 		*
-		* - Add<Transform>(player, {x, y, z});
+		*    ecs.SetResource<Time>({ 0.016f });
+		*    float dt = ecs.Resource<Time>().delta;
+		*
+		*  Resources aren't part of snapshots.
 		*/
 		template <typename T>
-		T& Add(EntityID id, T&& component = {}) {
-			SEECS_ASSERT_VALID_ENTITY(id);
-			SEECS_ASSERT_ALIVE_ENTITY(id);
+		T& SetResource(T value = {}) {
+			size_t index = GetResourceIndex<T>();
+			if (index >= m_resources.size()) {
+				m_resources.resize(index + 1);
+				m_resourceData.resize(index + 1, nullptr);
+			}
 
-			SparseSet<T>& pool = GetComponentPool<T>();
+			auto slot = std::make_unique<ResourceSlot<T>>(std::move(value));
+			m_resourceData[index] = &slot->value;
+			m_resources[index] = std::move(slot);
 
-			// If component already exists, overwrite
-			if (pool.Get(id))
-				return *pool.Set(id, std::move(component));
+			return *static_cast<T*>(m_resourceData[index]);
+		}
 
-			ComponentMask& mask = GetEntityMask(id);
+		/*
+		*  Returns a resource set with SetResource(), Resource<const T>() returns a const reference.
+		*  The reference stays valid until the resource is set again or removed.
+		*/
+		template <typename T>
+		T& Resource() {
+			size_t index = GetResourceIndex<std::remove_const_t<T>>();
+			SEECS_ASSERT(index < m_resourceData.size() && m_resourceData[index],
+				"No resource of type '" << typeid(T).name() << "'");
+			return *static_cast<T*>(m_resourceData[index]);
+		}
+
+		template <typename T>
+		bool HasResource() {
+			size_t index = GetResourceIndex<std::remove_const_t<T>>();
+			return index < m_resourceData.size() && m_resourceData[index];
+		}
 
-			SetComponentBit<T>(mask, 1);
+		template <typename T>
+		void RemoveResource() {
+			size_t index = GetResourceIndex<T>();
+			if (index >= m_resources.size()) return;
 
-			SEECS_INFO("Attached '" << typeid(T).name() << "' to " << ENTITY_INFO(id));
-			return *pool.Set(id, std::move(component));
+			m_resources[index].reset();
+			m_resourceData[index] = nullptr;
 		}
 
 		/*
-		*  Retrieves the specified component for the given entity
+		*  Sends an event to be read next frame, instead of adding components that only live for
+		*  a frame (CollisionEvent, ...) and churn their pool. Safe to call from any number of
+		*  threads at once, every thread appends to its own buffer:
 		*
-		* - ecs.Get<Transform>(player);
+		*    ecs.Emit<Collision>({ a, b });
+		*    ecs.UpdateEvents();                              // End of frame
+		*    for (const Collision& hit : ecs.Events<Collision>())
+		*        ...
+		*
+		*  Channels are created on first use, which isn't thread safe, so RegisterEvents()
+		*  the events emitted from parallel systems.
 		*/
-		template <typename T>
-		T& Get(EntityID id) {
-			SEECS_ASSERT_VALID_ENTITY(id);
-			SEECS_ASSERT_ALIVE_ENTITY(id);
+		template <typename E>
+		void Emit(E event) {
+			GetEventChannel<E>().Emit(std::move(event));
+		}
 
-			SparseSet<T>& pool = GetComponentPool<T>();
-			T* component = pool.Get(id);
-			SEECS_ASSERT(component,
-				ENTITY_INFO(id) << " missing component in '" << typeid(T).name() << "' pool");
+		/*
+		*  Events emitted before the last UpdateEvents(), valid until the next one.
+		*  They're grouped by the writer slot of the emitting thread, in slot order. A thread takes
+		*  the slot most recently freed by an exiting thread (LIFO), or else the next unused one,
+		*  so sort them when the order has to be deterministic.
+		*/
+		template <typename E>
+		Span<const E> Events() {
+			size_t index = GetEventIndex<E>();
+			if (index >= m_eventChannels.size() || !m_eventChannels[index])
+				return { nullptr, 0 };
+			return static_cast<const EventChannel<E>*>(m_eventChannels[index].get())->Read();
+		}
 
-			return *component;
+		template <typename... Es>
+		void RegisterEvents() {
+			(GetEventChannel<Es>(), ...);
 		}
 
 		/*
-		*  Retrieves a pointer to the specified component for the given entity
+		*  Ends the frame for every event channel: what was emitted since the last call becomes
+		*  readable, and the events read this frame are dropped. Must run while no thread is emitting.
+		*/
+		void UpdateEvents() {
+			for (auto& channel : m_eventChannels)
+				if (channel)
+					channel->Update();
+		}
+
+		/*
+		*  Adds a secondary index on a component field, kept in sync by Add(), Remove(),
+		*  Patch() and entity deletion. A hash index answers Find/FindAll in O(1),
+		*  an ordered one also answers FindRange, in O(log n):
 		*
-		* - ecs.GetPtr<Transform>(player);
+		*    ecs.AddHashIndex<&NetworkId::value>();
+		*    EntityID player = ecs.Find<&NetworkId::value>(42);
+		*
+		*    ecs.AddOrderedIndex<&Unit::level>();
+		*    for (EntityID id : ecs.FindRange<&Unit::level>(10, 20)) { ... }
+		*
+		*  Indexed fields must only be written through Patch() (or by re-adding the component).
 		*/
-		template <typename T>
-		T* GetPtr(EntityID id) {
-			SEECS_ASSERT_VALID_ENTITY(id);
-			SEECS_ASSERT_ALIVE_ENTITY(id);
+		template <auto Member>
+		void AddHashIndex() {
+			using T = typename member_traits<decltype(Member)>::class_type;
+			static_assert(!is_soa_v<T>, "SoA components can't be indexed");
+			GetComponentPool<T>().AddIndex(typeid(HashIndex<Member>), std::make_unique<HashIndex<Member>>());
+		}
 
-			SparseSet<T>& pool = GetComponentPool<T>();
-			return pool.Get(id);
+		template <auto Member>
+		void AddOrderedIndex() {
+			using T = typename member_traits<decltype(Member)>::class_type;
+			static_assert(!is_soa_v<T>, "SoA components can't be indexed");
+			GetComponentPool<T>().AddIndex(typeid(OrderedIndex<Member>), std::make_unique<OrderedIndex<Member>>());
+		}
+
+		// Any entity whose field equals value, or NULL_ENTITY if there is none
+		template <auto Member>
+		EntityID Find(const typename member_traits<decltype(Member)>::field_type& value) {
+			using T = typename member_traits<decltype(Member)>::class_type;
+			ComponentPool<T>& pool = GetComponentPool<T>();
+
+			if (auto* hash = pool.GetIndex(typeid(HashIndex<Member>))) {
+				Span<const EntityID> found = static_cast<HashIndex<Member>*>(hash)->Find(value);
+				return found.empty() ? NULL_ENTITY : found[0];
+			}
+
+			std::vector<EntityID> found = FindRange<Member>(value, value);
+			return found.empty() ? NULL_ENTITY : found[0];
+		}
+
+		// Every entity whose field equals value
+		template <auto Member>
+		std::vector<EntityID> FindAll(const typename member_traits<decltype(Member)>::field_type& value) {
+			using T = typename member_traits<decltype(Member)>::class_type;
+			ComponentPool<T>& pool = GetComponentPool<T>();
+
+			if (auto* hash = pool.GetIndex(typeid(HashIndex<Member>))) {
+				Span<const EntityID> found = static_cast<HashIndex<Member>*>(hash)->Find(value);
+				return { found.begin(), found.end() };
+			}
+
+			return FindRange<Member>(value, value);
+		}
+
+		// Every entity whose field lies within [low, high], needs an ordered index
+		template <auto Member>
+		std::vector<EntityID> FindRange(const typename member_traits<decltype(Member)>::field_type& low,
+			const typename member_traits<decltype(Member)>::field_type& high) {
+			using T = typename member_traits<decltype(Member)>::class_type;
+
+			auto* ordered = GetComponentPool<T>().GetIndex(typeid(OrderedIndex<Member>));
+			SEECS_ASSERT(ordered, "No index on field of component '" << typeid(T).name() << "'");
+
+			return static_cast<OrderedIndex<Member>*>(ordered)->FindRange(low, high);
 		}
 
 		/*
-		*  Removes a component from an entity
+		*  Modifies an entity's component through func(T&), updating indexes on it
 		*
-		* - ecs.Remove<Transform>(player);
+		*    ecs.Patch<Unit>(id, [](Unit& unit) { unit.level++; });
 		*/
-		template <typename T>
-		void Remove(EntityID id) {
+		template <typename T, typename Func>
+		void Patch(EntityID id, Func func) {
+			static_assert(!is_soa_v<T>, "SoA components can't be patched");
 			SEECS_ASSERT_VALID_ENTITY(id);
 			SEECS_ASSERT_ALIVE_ENTITY(id);
+			SEECS_ASSERT(Has<T>(id), "Entity " << ENTITY_INFO(id) << " has no component '" << typeid(T).name() << "' to patch");
 
-			SparseSet<T>& pool = GetComponentPool<T>();
-
-			if (!pool.Get(id)) return;
-
-			ComponentMask& mask = GetEntityMask(id);
-			SetComponentBit<T>(mask, 0);
-
-			pool.Delete(id);
-			SEECS_INFO("Removed '" << typeid(T).name() << "' from " << ENTITY_INFO(id));
+			GetComponentPool<T>().Patch(id, func);
 		}
 
 		template <typename... Ts>
@@ -715,7 +5021,18 @@ namespace seecs {
 		template <typename... Components>
 		SimpleView<Components...> View() {
 			// Pass a copy of array from fold expression into view.
-			return { { GetComponentPoolPtr<Components>()... } };
+			return { { GetComponentPoolPtr<std::remove_const_t<Components>>()... } };
+		}
+
+		/*
+		*   Create a ComponentAccessor for repeated random access to the given components
+		*
+		*   - auto acc = ecs.Accessor<A, B>();
+		*   - acc.Get<A>(id);
+		*/
+		template <typename... Components>
+		ComponentAccessor<Components...> Accessor() {
+			return { &GetComponentPool<std::remove_const_t<Components>>()... };
 		}
 
 		size_t GetEntityCount() {
@@ -745,6 +5062,285 @@ namespace seecs {
 
 	};
 
+
+
+	/*
+	*  Template for spawning entities, holding a prototype value for each of its components:
+	*
+	*    seecs::Prefab enemy;
+	*    enemy.Add<Transform>({ ... }).Add<Health>({ 100 }).Add<Enemy>();
+	*
+	*    std::vector<EntityID> wave = ecs.Instantiate(enemy, 5000);
+	*
+	*  Instantiating grows each pool once and copies the prototype into it for every entity.
+	*  A Prefab isn't tied to an ECS, it can be instantiated into any of them.
+	*/
+	class Prefab {
+	private:
+
+		friend class ECS;
+
+		struct IPrototype {
+			virtual ~IPrototype() = default;
+			virtual void Instantiate(ECS& ecs, const EntityID* ids, size_t count) const = 0;
+		};
+
+		template <typename T>
+		struct Prototype : IPrototype {
+			T value;
+
+			Prototype(T&& value) : value{ std::move(value) } {}
+
+			void Instantiate(ECS& ecs, const EntityID* ids, size_t count) const override {
+				ecs.GetComponentPool<T>().Fill(ids, count, value);
+
+				if (ecs.m_trace)
+					for (size_t i = 0; i < count; i++)
+						ecs.RecordComponent(Trace::Op::Add, ECS::GetComponentIndex<T>(), ids[i], &value);
+			}
+		};
+
+		ECS::ComponentMask m_mask;
+
+		// Indexed by component index
+		std::vector<std::shared_ptr<const IPrototype>> m_prototypes;
+
+	public:
+
+		// Adds or replaces the prototype value of a component
+		template <typename T>
+		Prefab& Add(T value = {}) {
+			static_assert(!std::is_same_v<T, Hierarchy>, "Prefabs can't hold a Hierarchy, parent instances with ECS::SetParent()");
+
+			size_t index = ECS::GetComponentIndex<T>();
+			if (index >= m_prototypes.size())
+				m_prototypes.resize(index + 1);
+
+			m_prototypes[index] = std::make_shared<Prototype<T>>(std::move(value));
+			m_mask.set(index);
+			return *this;
+		}
+
+		template <typename T>
+		void Remove() {
+			size_t index = ECS::GetComponentIndex<T>();
+			if (index >= m_prototypes.size()) return;
+
+			m_prototypes[index].reset();
+			m_mask.reset(index);
+		}
+
+		template <typename T>
+		bool Has() const {
+			return m_mask[ECS::GetComponentIndex<T>()];
+		}
+
+	};
+
+	inline std::vector<EntityID> ECS::Instantiate(const Prefab& prefab, size_t count) {
+		SEECS_ASSERT(CheckRoom(count, prefab.m_mask) != Result::PoolFull, "Pool capacity exceeded instantiating a prefab");
+		std::vector<EntityID> ids = AllocateEntities(count, prefab.m_mask);
+
+		// Traced as separate entities, the prefab itself isn't part of the trace
+		if (m_trace)
+			for (EntityID id : ids)
+				Record(Trace::Op::Create, { id, 0 });
+
+		for (const auto& prototype : prefab.m_prototypes)
+			if (prototype)
+				prototype->Instantiate(*this, ids.data(), count);
+
+		return ids;
+	}
+
+	inline Result ECS::TryInstantiate(const Prefab& prefab, std::vector<EntityID>& ids, size_t count) {
+		Result result = CheckRoom(count, prefab.m_mask);
+		if (result == Result::Ok)
+			ids = Instantiate(prefab, count);
+		return result;
+	}
+
+
+
+	/*
+	*  Records entity creation and component attachment from a worker thread,
+	*  to be applied to the world later at a sync point:
+	*
+	*    // One buffer per job/thread
+	*    CommandBuffer& commands = buffers[thread];
+	*    EntityID bullet = commands.CreateEntity();
+	*    commands.Add<Transform>(bullet, { ... });
+	*
+	*    // Main thread, after the jobs finished
+	*    for (CommandBuffer& commands : buffers)
+	*        commands.Commit();
+	*
+	*  IDs are reserved immediately, in batches of RESERVE_BATCH from ECS::ReserveEntities(),
+	*  so they can be stored and referenced before the entity exists.
+	*  A single buffer must only be used by one thread at a time.
+	*
+	*  In deterministic mode (see ECS::SetDeterministic()) CreateEntity() returns a provisional ID
+	*  instead, only meaningful to this buffer. Commit() creates the entities in the order they were
+	*  recorded and swaps in the real IDs for the staged components, Resolve() maps them afterwards.
+	*  Provisional IDs stored inside component data aren't remapped.
+	*/
+	class CommandBuffer {
+	public:
+
+		static constexpr size_t RESERVE_BATCH = 64;
+
+		// Set on provisional IDs, the rest of the bits index the entities created by the buffer
+		static constexpr EntityID PROVISIONAL_BIT = EntityID(1) << 63;
+
+	private:
+
+		struct IStagedComponents {
+			virtual ~IStagedComponents() = default;
+			virtual void Commit(ECS& ecs, const CommandBuffer& buffer) = 0;
+		};
+
+		template <typename T>
+		struct StagedComponents : IStagedComponents {
+			std::vector<std::pair<EntityID, T>> components;
+
+			void Commit(ECS& ecs, const CommandBuffer& buffer) override {
+				for (auto& [id, component] : components)
+					ecs.Add<T>(buffer.Resolve(id), std::move(component));
+				components.clear();
+			}
+		};
+
+		ECS& m_ecs;
+
+		// Reserved but not yet handed out by CreateEntity(), kept in reverse
+		std::vector<EntityID> m_reserved;
+
+		// Names can't be interned from other threads, they're copied until the commit
+		std::vector<std::pair<EntityID, std::string>> m_created;
+
+		// Indexed by component index, committed in that order
+		std::vector<std::unique_ptr<IStagedComponents>> m_staged;
+
+		// Real IDs of the provisional ones, filled by Commit()
+		std::vector<EntityID> m_resolved;
+
+		// Hands reserved IDs that never became entities back to the ECS free list
+		void ReleaseReserved() {
+			m_ecs.FlushReservations();
+			m_ecs.m_availableEntities.insert(m_ecs.m_availableEntities.end(), m_reserved.begin(), m_reserved.end());
+			if (!m_reserved.empty())
+				m_ecs.m_freeListSorted = false;
+			m_reserved.clear();
+		}
+
+	public:
+
+		CommandBuffer(ECS& ecs) :
+			m_ecs{ ecs }
+		{}
+
+		/*
+		*  Dropping a buffer without committing it discards what it staged, the IDs
+		*  it reserved go back to the ECS free list. Same threading rules as Commit().
+		*/
+		~CommandBuffer() {
+			for (auto& [id, name] : m_created)
+				if (!(id & PROVISIONAL_BIT))
+					m_reserved.push_back(id);
+			if (!m_reserved.empty())
+				ReleaseReserved();
+		}
+
+		// Moved from buffers are left empty, and release nothing
+		CommandBuffer(CommandBuffer&&) = default;
+
+		EntityID CreateEntity(std::string_view name = "") {
+			if (m_ecs.IsDeterministic()) {
+				EntityID id = PROVISIONAL_BIT | m_created.size();
+				m_created.push_back({ id, std::string{ name } });
+				return id;
+			}
+
+			if (m_reserved.empty()) {
+				m_reserved.resize(RESERVE_BATCH);
+				m_ecs.ReserveEntities(RESERVE_BATCH, m_reserved.data());
+				std::reverse(m_reserved.begin(), m_reserved.end());
+			}
+
+			EntityID id = m_reserved.back();
+			m_reserved.pop_back();
+
+			m_created.push_back({ id, std::string{ name } });
+			return id;
+		}
+
+		/*
+		*  Stages a component for an entity created by this buffer,
+		*  or any entity that is still alive at commit time.
+		*/
+		template <typename T>
+		void Add(EntityID id, T&& component = {}) {
+			size_t index = ECS::GetComponentIndex<T>();
+			if (index >= m_staged.size())
+				m_staged.resize(index + 1);
+			if (!m_staged[index])
+				m_staged[index] = std::make_unique<StagedComponents<T>>();
+
+			static_cast<StagedComponents<T>*>(m_staged[index].get())->components.push_back({ id, std::move(component) });
+		}
+
+		/*
+		*  Creates the staged entities and attaches their components.
+		*  Must be called from the main thread while no other thread is using the ECS.
+		*  Unused reserved IDs go back to the ECS free list.
+		*/
+		void Commit() {
+			m_ecs.FlushReservations();
+
+			m_resolved.clear();
+			for (auto& [id, name] : m_created) {
+				if (id & PROVISIONAL_BIT)
+					m_resolved.push_back(m_ecs.CreateEntity(name));
+				else
+					m_ecs.MaterializeEntity(id, name);
+			}
+			m_created.clear();
+
+			for (auto& staged : m_staged)
+				if (staged)
+					staged->Commit(m_ecs, *this);
+
+			ReleaseReserved();
+		}
+
+		/*
+		*  Real ID of a provisional ID from the last Commit(), other IDs are returned as is.
+		*/
+		EntityID Resolve(EntityID id) const {
+			if (!(id & PROVISIONAL_BIT))
+				return id;
+
+			size_t index = id & ~PROVISIONAL_BIT;
+			SEECS_ASSERT(index < m_resolved.size(), "Provisional ID " << index << " hasn't been committed");
+			return m_resolved[index];
+		}
+
+	};
+
+
+
+	/*
+	*  Rebuilds a world from a full snapshot followed by a chain of deltas,
+	*  each taken right after the one before it.
+	*/
+	inline void ReplaySnapshots(ECS& ecs, const Snapshot& base, const std::vector<Snapshot>& deltas) {
+		SEECS_ASSERT(!base.isDelta, "Snapshot replay must start from a full snapshot");
+
+		ecs.ApplySnapshot(base);
+		for (const Snapshot& delta : deltas)
+			ecs.ApplySnapshot(delta);
+	}
+
 }
 
 #endif
\ No newline at end of file